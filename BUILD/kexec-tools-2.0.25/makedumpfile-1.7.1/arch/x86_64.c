@@ -323,9 +323,11 @@ get_versiondep_info_x86_64(void)
 
 /*
  * Translate a virtual address to a physical address by using 4 levels paging.
+ * If size is not NULL, the size of the page which maps vaddr is stored there.
  */
 unsigned long long
-__vtop4_x86_64(unsigned long vaddr, unsigned long pagetable)
+__vtop4_x86_64(unsigned long vaddr, unsigned long pagetable,
+	       unsigned long long *size)
 {
 	unsigned long page_dir, pgd, pud_paddr, pud_pte, pmd_paddr, pmd_pte;
 	unsigned long pte_paddr, pte;
@@ -406,9 +408,12 @@ __vtop4_x86_64(unsigned long vaddr, unsigned long pagetable)
 		ERRMSG("Can't get a valid pud_pte.\n");
 		return NOT_PADDR;
 	}
-	if (pud_pte & _PAGE_PSE)	/* 1GB pages */
+	if (pud_pte & _PAGE_PSE) {	/* 1GB pages */
+		if (size)
+			*size = PUD_SIZE;
 		return (pud_pte & entry_mask & PUD_MASK) +
 			(vaddr & ~PUD_MASK);
+	}
 
 	/*
 	 * Get PMD.
@@ -426,9 +431,12 @@ __vtop4_x86_64(unsigned long vaddr, unsigned long pagetable)
 		ERRMSG("Can't get a valid pmd_pte.\n");
 		return NOT_PADDR;
 	}
-	if (pmd_pte & _PAGE_PSE)	/* 2MB pages */
+	if (pmd_pte & _PAGE_PSE) {	/* 2MB pages */
+		if (size)
+			*size = PMD_SIZE;
 		return (pmd_pte & entry_mask & PMD_MASK) +
 			(vaddr & ~PMD_MASK);
+	}
 
 	/*
 	 * Get PTE.
@@ -446,11 +454,13 @@ __vtop4_x86_64(unsigned long vaddr, unsigned long pagetable)
 		ERRMSG("Can't get a valid pte.\n");
 		return NOT_PADDR;
 	}
+	if (size)
+		*size = PAGESIZE();
 	return (pte & entry_mask) + PAGEOFFSET(vaddr);
 }
 
 unsigned long long
-vtop4_x86_64(unsigned long vaddr)
+vtop4_x86_64_size(unsigned long vaddr, unsigned long long *size)
 {
 	unsigned long pagetable;
 	unsigned long init_level4_pgt;
@@ -466,13 +476,19 @@ vtop4_x86_64(unsigned long vaddr)
 
 	pagetable = init_level4_pgt - __START_KERNEL_map + info->phys_base;
 
-	return __vtop4_x86_64(vaddr, pagetable);
+	return __vtop4_x86_64(vaddr, pagetable, size);
+}
+
+unsigned long long
+vtop4_x86_64(unsigned long vaddr)
+{
+	return vtop4_x86_64_size(vaddr, NULL);
 }
 
 unsigned long long
 vtop4_x86_64_pagetable(unsigned long vaddr, unsigned long pagetable)
 {
-	return __vtop4_x86_64(vaddr, pagetable);
+	return __vtop4_x86_64(vaddr, pagetable, NULL);
 }
 
 /*
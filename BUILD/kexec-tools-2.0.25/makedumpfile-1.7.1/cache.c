@@ -26,28 +26,55 @@ struct cache {
 
 /* 8 pages covers 4-level paging plus 4 data pages */
 #define CACHE_SIZE	8
-static struct cache_entry entries[CACHE_SIZE];
-static struct cache_entry *pool[CACHE_SIZE];
-static int avail = CACHE_SIZE;
+static struct cache_entry *entries;
+static struct cache_entry **pool;
+static int cache_size;
+static int avail;
 
 static struct cache used, pending;
 
+/*
+ * Entries which cache exactly one page are hashed by the page frame
+ * number. The others (mmap()ed regions) are few and kept on the
+ * ranges list.
+ */
+static struct cache_entry **hash_table;
+static unsigned long hash_mask;
+static struct cache_entry *ranges;
+
 static void *cachebuf;
 
 int
 cache_init(void)
 {
+	unsigned long hash_size;
 	int i;
 
-	cachebuf = malloc(info->page_size * CACHE_SIZE);
-	if (cachebuf == NULL) {
+	cache_size = CACHE_SIZE;
+	if (info->cache_size > 0)
+		cache_size = MAX(cache_size,
+				 info->cache_size * 1024 / info->page_size);
+
+	for (hash_size = 1; hash_size < cache_size; hash_size <<= 1)
+		;
+	hash_mask = hash_size - 1;
+
+	cachebuf = malloc(info->page_size * cache_size);
+	entries = calloc(cache_size, sizeof(*entries));
+	pool = malloc(sizeof(*pool) * cache_size);
+	hash_table = calloc(hash_size, sizeof(*hash_table));
+	if (cachebuf == NULL || entries == NULL || pool == NULL ||
+	    hash_table == NULL) {
 		ERRMSG("Can't allocate memory for cache. %s\n",
 		       strerror(errno));
 		return FALSE;
 	}
 
-	for (i = 0; i < CACHE_SIZE; ++i)
+	for (i = 0; i < cache_size; ++i)
 		pool[i] = &entries[i];
+	avail = cache_size;
+
+	DEBUG_MSG("Cache size   : %d pages\n", cache_size);
 
 	return TRUE;
 }
@@ -78,23 +105,67 @@ remove_entry(struct cache *cache, struct cache_entry *entry)
 		cache->head = entry->next;
 }
 
-void *
-cache_search(unsigned long long paddr, unsigned long length)
+static struct cache_entry **
+lookup_chain(struct cache_entry *entry)
 {
-	struct cache_entry *entry;
-	for (entry = used.head; entry; entry = entry->next) {
+	if (entry->buflen == info->page_size && !PAGEOFFSET(entry->paddr))
+		return &hash_table[(entry->paddr >> PAGESHIFT()) & hash_mask];
+	return &ranges;
+}
+
+static void
+link_entry(struct cache_entry *entry)
+{
+	struct cache_entry **chain = lookup_chain(entry);
+
+	entry->hnext = *chain;
+	*chain = entry;
+}
+
+static void
+unlink_entry(struct cache_entry *entry)
+{
+	struct cache_entry **p;
+
+	for (p = lookup_chain(entry); *p; p = &(*p)->hnext) {
+		if (*p == entry) {
+			*p = entry->hnext;
+			break;
+		}
+	}
+}
+
+static struct cache_entry *
+search_chain(struct cache_entry *entry, unsigned long long paddr,
+	     unsigned long length)
+{
+	for (; entry; entry = entry->hnext) {
 		size_t off = paddr - entry->paddr;
 		if (off < entry->buflen &&
-		    length <= entry->buflen - off) {
-			if (entry != used.head) {
-				remove_entry(&used, entry);
-				add_entry(&used, entry);
-			}
-			return entry->bufptr + off;
-		}
+		    length <= entry->buflen - off)
+			return entry;
 	}
 
-	return NULL;		/* cache miss */
+	return NULL;
+}
+
+void *
+cache_search(unsigned long long paddr, unsigned long length)
+{
+	struct cache_entry *entry;
+
+	entry = search_chain(hash_table[(paddr >> PAGESHIFT()) & hash_mask],
+			     paddr, length);
+	if (!entry)
+		entry = search_chain(ranges, paddr, length);
+	if (!entry)
+		return NULL;		/* cache miss */
+
+	if (entry != used.head) {
+		remove_entry(&used, entry);
+		add_entry(&used, entry);
+	}
+	return entry->bufptr + (paddr - entry->paddr);
 }
 
 struct cache_entry *
@@ -108,6 +179,7 @@ cache_alloc(unsigned long long paddr)
 	} else if (used.tail) {
 		entry = used.tail;
 		remove_entry(&used, entry);
+		unlink_entry(entry);
 		if (entry->discard)
 			entry->discard(entry);
 	} else
@@ -128,6 +200,7 @@ cache_add(struct cache_entry *entry)
 {
 	remove_entry(&pending, entry);
 	add_entry(&used, entry);
+	link_entry(entry);
 }
 
 void
@@ -136,3 +209,74 @@ cache_free(struct cache_entry *entry)
 	remove_entry(&pending, entry);
 	pool[avail++] = entry;
 }
+
+/*
+ * Virtual-to-physical translation cache.
+ *
+ * Each entry maps a whole page, so a hit saves a page table walk. Base
+ * pages are indexed by the page frame number. Huge pages are indexed by
+ * the VTOP_HUGE_SHIFT-sized slot which contains the translated address,
+ * and the entry covers the whole huge page, so 1GB pages also hit in the
+ * neighbouring addresses of the same slot.
+ */
+#define VTOP_CACHE_SIZE		1024
+#define VTOP_HUGE_CACHE_SIZE	256
+#define VTOP_HUGE_SHIFT		21
+
+struct vtop_entry {
+	unsigned long long vaddr;
+	unsigned long long paddr;
+	unsigned long long size;	/* 0 if unused */
+};
+
+static struct vtop_entry vtop_entries[VTOP_CACHE_SIZE];
+static struct vtop_entry vtop_huge_entries[VTOP_HUGE_CACHE_SIZE];
+
+static inline struct vtop_entry *
+vtop_slot(unsigned long long vaddr, int huge)
+{
+	if (huge)
+		return &vtop_huge_entries[(vaddr >> VTOP_HUGE_SHIFT) %
+					  VTOP_HUGE_CACHE_SIZE];
+	return &vtop_entries[(vaddr >> PAGESHIFT()) % VTOP_CACHE_SIZE];
+}
+
+void
+vtop_cache_flush(void)
+{
+	memset(vtop_entries, 0, sizeof(vtop_entries));
+	memset(vtop_huge_entries, 0, sizeof(vtop_huge_entries));
+}
+
+unsigned long long
+vtop_cache_search(unsigned long long vaddr)
+{
+	struct vtop_entry *entry;
+
+	entry = vtop_slot(vaddr, FALSE);
+	if (vaddr - entry->vaddr < entry->size)
+		return entry->paddr + (vaddr - entry->vaddr);
+
+	entry = vtop_slot(vaddr, TRUE);
+	if (vaddr - entry->vaddr < entry->size)
+		return entry->paddr + (vaddr - entry->vaddr);
+
+	return NOT_PADDR;	/* cache miss */
+}
+
+void
+vtop_cache_add(unsigned long long vaddr, unsigned long long paddr,
+	       unsigned long long size)
+{
+	struct vtop_entry *entry;
+	unsigned long long offset;
+
+	if (size < PAGESIZE() || (size & (size - 1)))
+		return;
+
+	offset = vaddr & (size - 1);
+	entry = vtop_slot(vaddr, size > PAGESIZE());
+	entry->vaddr = vaddr - offset;
+	entry->paddr = paddr - offset;
+	entry->size = size;
+}
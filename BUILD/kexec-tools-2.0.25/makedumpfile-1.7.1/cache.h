@@ -24,6 +24,7 @@ struct cache_entry {
 	void *bufptr;
 	unsigned long buflen;
 	struct cache_entry *next, *prev;
+	struct cache_entry *hnext;	/* hash chain or ranges list */
 
 	void (*discard)(struct cache_entry *);
 };
@@ -34,4 +35,9 @@ struct cache_entry *cache_alloc(unsigned long long paddr);
 void cache_add(struct cache_entry *entry);
 void cache_free(struct cache_entry *entry);
 
+void vtop_cache_flush(void);
+unsigned long long vtop_cache_search(unsigned long long vaddr);
+void vtop_cache_add(unsigned long long vaddr, unsigned long long paddr,
+		    unsigned long long size);
+
 #endif	/* _CACHE_H */
@@ -88,6 +88,8 @@ struct kdump_sub_header {
 	unsigned long long start_pfn_64;  /* header_version 6 and later */
 	unsigned long long end_pfn_64;	  /* header_version 6 and later */
 	unsigned long long max_mapnr_64;  /* header_version 6 and later */
+	off_t		offset_zstd_dict; /* header_version 7 and later */
+	unsigned long	size_zstd_dict;   /* header_version 7 and later */
 };
 
 /* page flags */
@@ -99,6 +101,22 @@ struct kdump_sub_header {
 					/* indicate an incomplete dumpfile */
 #define DUMP_DH_EXCLUDED_VMEMMAP 0x10	/* unused vmemmap pages are excluded */
 #define DUMP_DH_COMPRESSED_ZSTD  0x20	/* page is compressed with zstd */
+#define DUMP_DH_FILLED_PAGE	0x40	/* page is filled with the 8 bytes */
+					/* in offset, and has no data */
+#define DUMP_DH_FILLED_PAGES	0x80	/* some pages are DUMP_DH_FILLED_PAGE */
+#define DUMP_DH_DEDUP_PAGES	0x100	/* identical pages share their data */
+#define DUMP_DH_EXTENT		0x200	/* page is compressed in a frame */
+					/* with the following pages */
+#define DUMP_DH_COMPRESSED_LZ4	0x400	/* page is compressed with lz4 */
+
+/*
+ * page_flags of a page in a frame: the number of pages in the frame,
+ * and the index of the page in it.
+ */
+#define EXTENT_PAGE_FLAGS(nr, index)	(((unsigned long long)(nr) << 16) \
+					 | (index))
+#define EXTENT_NR_PAGES(page_flags)	(((page_flags) >> 16) & 0xffff)
+#define EXTENT_PAGE_INDEX(page_flags)	((page_flags) & 0xffff)
 
 /* descriptor of each page for vmcore */
 typedef struct page_desc {
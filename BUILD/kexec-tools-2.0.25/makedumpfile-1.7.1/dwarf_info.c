@@ -57,6 +57,48 @@ static struct dwarf_info	dwarf_info = {
 	.fd_debuginfo = -1,
 };
 
+/*
+ * Hash index of names, used to look up DIEs and symbols without
+ * walking the whole debuginfo for each query.  The names point into
+ * the string tables of the debuginfo, so an index is only valid while
+ * its dwfl session is open.
+ */
+#define NAME_HASH_SIZE		(1 << 16)
+
+struct name_entry {
+	const char		*name;
+	unsigned long long	value;	/* DIE offset or symbol value */
+	unsigned int		hash;
+	unsigned int		next;	/* index + 1 of the next entry */
+};
+
+struct name_index {
+	unsigned int		*bucket; /* index + 1 of the first entry */
+	struct name_entry	*entry;
+	unsigned int		num_entry;
+	unsigned int		max_entry;
+};
+
+struct dwarf_index {
+	struct name_index	die;
+	struct name_index	symbol;
+	unsigned long long	*symbol_value;	/* sorted symbol values */
+	unsigned int		num_symbol_value;
+};
+static struct dwarf_index	dwarf_index;
+
+/*
+ * The session of vmlinux is kept while the debuginfo is switched to
+ * a kernel module, so that switching back does not need to index
+ * vmlinux again.
+ */
+static struct {
+	Dwfl			*dwfl;
+	Dwarf			*dwarfd;
+	Elf			*elfd;
+	struct dwarf_index	index;
+} vmlinux_session;
+
 
 /*
  * Internal functions.
@@ -171,6 +213,24 @@ dwfl_report_module_p(const char *modname, const char *filename)
 	return 0;
 }
 
+static void
+free_name_index(struct name_index *index)
+{
+	free(index->bucket);
+	free(index->entry);
+	memset(index, 0, sizeof(struct name_index));
+}
+
+static void
+free_dwarf_index(struct dwarf_index *index)
+{
+	free_name_index(&index->die);
+	free_name_index(&index->symbol);
+	free(index->symbol_value);
+	index->symbol_value = NULL;
+	index->num_symbol_value = 0;
+}
+
 static void
 clean_dwfl_info(void)
 {
@@ -180,6 +240,33 @@ clean_dwfl_info(void)
 	dwarf_info.dwfl = NULL;
 	dwarf_info.dwarfd = NULL;
 	dwarf_info.elfd = NULL;
+
+	free_dwarf_index(&dwarf_index);
+}
+
+static void
+save_vmlinux_session(void)
+{
+	vmlinux_session.dwfl   = dwarf_info.dwfl;
+	vmlinux_session.dwarfd = dwarf_info.dwarfd;
+	vmlinux_session.elfd   = dwarf_info.elfd;
+	vmlinux_session.index  = dwarf_index;
+
+	dwarf_info.dwfl = NULL;
+	dwarf_info.dwarfd = NULL;
+	dwarf_info.elfd = NULL;
+	memset(&dwarf_index, 0, sizeof(struct dwarf_index));
+}
+
+static void
+restore_vmlinux_session(void)
+{
+	dwarf_info.dwfl   = vmlinux_session.dwfl;
+	dwarf_info.dwarfd = vmlinux_session.dwarfd;
+	dwarf_info.elfd   = vmlinux_session.elfd;
+	dwarf_index       = vmlinux_session.index;
+
+	memset(&vmlinux_session, 0, sizeof(vmlinux_session));
 }
 
 /*
@@ -277,6 +364,12 @@ init_dwarf_info(void)
 		.find_debuginfo  = dwarf_no_debuginfo_found
 	};
 
+	/*
+	 * The session is kept until the debuginfo is switched.
+	 */
+	if (dwarf_info.dwfl)
+		return TRUE;
+
 	dwarf_info.elfd = NULL;
 	dwarf_info.dwarfd = NULL;
 
@@ -609,61 +702,51 @@ search_member(Dwarf_Die *die)
 	return FALSE;
 }
 
-static void
-search_structure(Dwarf_Die *die, int *found)
+/*
+ * Check whether the die is the demanded structure or a typedef of it.
+ * Return TRUE if the search can be stopped.
+ */
+static int
+check_structure(Dwarf_Die *die, int *found)
 {
 	int tag;
 	const char *name;
 	Dwarf_Die die_type;
 
-	/*
-	 * If we get to here then we don't have any more
-	 * children, check to see if this is a relevant tag
-	 */
-	do {
-		tag  = dwarf_tag(die);
-		name = dwarf_diename(die);
-		if ((!name) || strcmp(name, dwarf_info.struct_name))
-			continue;
+	tag  = dwarf_tag(die);
+	name = dwarf_diename(die);
+	if ((!name) || strcmp(name, dwarf_info.struct_name))
+		return FALSE;
 
-		if (tag == DW_TAG_typedef) {
-			if (!get_die_type(die, &die_type)) {
-				ERRMSG("Can't get CU die of DW_AT_type.\n");
-				break;
-			}
+	if (tag == DW_TAG_typedef) {
+		if (!get_die_type(die, &die_type)) {
+			ERRMSG("Can't get CU die of DW_AT_type.\n");
+			return TRUE;
+		}
 
-			/* Resolve typedefs of typedefs. */
-			while ((tag = dwarf_tag(&die_type)) == DW_TAG_typedef) {
-				if (!get_die_type(&die_type, &die_type)) {
-					ERRMSG("Can't get CU die of DW_AT_type.\n");
-					return;
-				}
+		/* Resolve typedefs of typedefs. */
+		while ((tag = dwarf_tag(&die_type)) == DW_TAG_typedef) {
+			if (!get_die_type(&die_type, &die_type)) {
+				ERRMSG("Can't get CU die of DW_AT_type.\n");
+				return TRUE;
 			}
-
-			if (tag != DW_TAG_structure_type)
-				continue;
-			die = &die_type;
-
-		} else if (tag != DW_TAG_structure_type) {
-			continue;
 		}
 
-		/*
-		 * Skip if DW_AT_byte_size is not included.
-		 */
-		dwarf_info.struct_size = dwarf_bytesize(die);
+		if (tag != DW_TAG_structure_type)
+			return FALSE;
+		die = &die_type;
 
-		if (dwarf_info.struct_size > 0)
-			break;
+	} else if (tag != DW_TAG_structure_type) {
+		return FALSE;
+	}
 
-	} while (!dwarf_siblingof(die, die));
+	/*
+	 * Skip if DW_AT_byte_size is not included.
+	 */
+	dwarf_info.struct_size = dwarf_bytesize(die);
 
-	if (dwarf_info.struct_size <= 0) {
-		/*
-		 * Not found the demanded structure.
-		 */
-		return;
-	}
+	if (dwarf_info.struct_size <= 0)
+		return FALSE;
 
 	/*
 	 * Found the demanded structure.
@@ -679,10 +762,28 @@ search_structure(Dwarf_Die *die, int *found)
 		search_member(die);
 		break;
 	}
+	return TRUE;
 }
 
 static void
-search_number(Dwarf_Die *die, int *found)
+search_structure(Dwarf_Die *die, int *found)
+{
+	/*
+	 * If we get to here then we don't have any more
+	 * children, check to see if this is a relevant tag
+	 */
+	do {
+		if (check_structure(die, found))
+			break;
+	} while (!dwarf_siblingof(die, die));
+}
+
+/*
+ * Check the enumerators of the die.
+ * Return TRUE if the search can be stopped.
+ */
+static int
+check_number(Dwarf_Die *die, int *found)
 {
 	int tag, bytesize;
 	Dwarf_Word const_value;
@@ -690,134 +791,141 @@ search_number(Dwarf_Die *die, int *found)
 	Dwarf_Die child, *walker;
 	const char *name;
 
-	do {
-		tag  = dwarf_tag(die);
-		if (tag != DW_TAG_enumeration_type)
-			continue;
+	tag  = dwarf_tag(die);
+	if (tag != DW_TAG_enumeration_type)
+		return FALSE;
 
-		if (dwarf_info.cmd == DWARF_INFO_GET_ENUMERATION_TYPE_SIZE) {
-		   		   name = dwarf_diename(die);
+	if (dwarf_info.cmd == DWARF_INFO_GET_ENUMERATION_TYPE_SIZE) {
+		name = dwarf_diename(die);
 
-			if (!name || strcmp(name, dwarf_info.struct_name))
-			   	     continue;
+		if (!name || strcmp(name, dwarf_info.struct_name))
+			return FALSE;
 
-			if ((bytesize = dwarf_bytesize(die)) <= 0)
-			   	      	continue;
+		if ((bytesize = dwarf_bytesize(die)) <= 0)
+			return FALSE;
 
-			*found = TRUE;
+		*found = TRUE;
 
-			dwarf_info.struct_size = bytesize;
+		dwarf_info.struct_size = bytesize;
 
-			return;
-				}
+		return TRUE;
+	}
 
-		if (dwarf_child(die, &child) != 0)
-			continue;
+	if (dwarf_child(die, &child) != 0)
+		return FALSE;
 
-		walker = &child;
+	walker = &child;
 
-		do {
-			tag  = dwarf_tag(walker);
-			name = dwarf_diename(walker);
+	do {
+		tag  = dwarf_tag(walker);
+		name = dwarf_diename(walker);
 
-			if ((tag != DW_TAG_enumerator) || (!name)
-			    || strcmp(name, dwarf_info.enum_name))
-				continue;
+		if ((tag != DW_TAG_enumerator) || (!name)
+		    || strcmp(name, dwarf_info.enum_name))
+			continue;
 
-			if (!dwarf_attr(walker, DW_AT_const_value, &attr))
-				continue;
+		if (!dwarf_attr(walker, DW_AT_const_value, &attr))
+			continue;
 
-			if (dwarf_formudata(&attr, &const_value) < 0)
-				continue;
+		if (dwarf_formudata(&attr, &const_value) < 0)
+			continue;
 
-			*found = TRUE;
-			dwarf_info.enum_number = (long)const_value;
+		*found = TRUE;
+		dwarf_info.enum_number = (long)const_value;
 
-		} while (!dwarf_siblingof(walker, walker));
+	} while (!dwarf_siblingof(walker, walker));
 
-	} while (!dwarf_siblingof(die, die));
+	return FALSE;
 }
 
 static void
-search_typedef(Dwarf_Die *die, int *found)
+search_number(Dwarf_Die *die, int *found)
+{
+	do {
+		if (check_number(die, found))
+			return;
+	} while (!dwarf_siblingof(die, die));
+}
+
+/*
+ * Check whether the die is the demanded typedef.
+ * Return TRUE if the search can be stopped.
+ */
+static int
+check_typedef(Dwarf_Die *die, int *found)
 {
 	int tag = 0;
 	char *src_name = NULL;
 	const char *name;
 	Dwarf_Die die_type;
 
-	/*
-	 * If we get to here then we don't have any more
-	 * children, check to see if this is a relevant tag
-	 */
-	do {
-		tag  = dwarf_tag(die);
-		name = dwarf_diename(die);
+	tag  = dwarf_tag(die);
+	name = dwarf_diename(die);
 
-		if ((tag != DW_TAG_typedef) || (!name)
-		    || strcmp(name, dwarf_info.struct_name))
-			continue;
+	if ((tag != DW_TAG_typedef) || (!name)
+	    || strcmp(name, dwarf_info.struct_name))
+		return FALSE;
 
-		if (dwarf_info.cmd == DWARF_INFO_GET_TYPEDEF_SIZE) {
-			if (!get_die_type(die, &die_type)) {
-				ERRMSG("Can't get CU die of DW_AT_type.\n");
-				break;
-			}
+	if (dwarf_info.cmd == DWARF_INFO_GET_TYPEDEF_SIZE) {
+		if (!get_die_type(die, &die_type)) {
+			ERRMSG("Can't get CU die of DW_AT_type.\n");
+			return TRUE;
+		}
 
-			/* Resolve typedefs of typedefs. */
-			while ((tag = dwarf_tag(&die_type)) == DW_TAG_typedef) {
-				if (!get_die_type(&die_type, &die_type)) {
-					ERRMSG("Can't get CU die of DW_AT_type.\n");
-					return;
-				}
+		/* Resolve typedefs of typedefs. */
+		while ((tag = dwarf_tag(&die_type)) == DW_TAG_typedef) {
+			if (!get_die_type(&die_type, &die_type)) {
+				ERRMSG("Can't get CU die of DW_AT_type.\n");
+				return TRUE;
 			}
+		}
 
-			dwarf_info.struct_size = dwarf_bytesize(&die_type);
-			if (dwarf_info.struct_size <= 0)
-				continue;
+		dwarf_info.struct_size = dwarf_bytesize(&die_type);
+		if (dwarf_info.struct_size <= 0)
+			return FALSE;
 
-			*found = TRUE;
-			break;
-		} else if (dwarf_info.cmd == DWARF_INFO_GET_TYPEDEF_SRCNAME) {
-			src_name = (char *)dwarf_decl_file(die);
-			if (!src_name)
-				continue;
+		*found = TRUE;
+		return TRUE;
+	} else if (dwarf_info.cmd == DWARF_INFO_GET_TYPEDEF_SRCNAME) {
+		src_name = (char *)dwarf_decl_file(die);
+		if (!src_name)
+			return FALSE;
 
-			*found = TRUE;
-			strncpy(dwarf_info.src_name, src_name, LEN_SRCFILE-1);
-			dwarf_info.src_name[LEN_SRCFILE-1] = '\0';
-			break;
-		}
-	} while (!dwarf_siblingof(die, die));
+		*found = TRUE;
+		strncpy(dwarf_info.src_name, src_name, LEN_SRCFILE-1);
+		dwarf_info.src_name[LEN_SRCFILE-1] = '\0';
+		return TRUE;
+	}
+	return FALSE;
 }
 
 static void
-search_symbol(Dwarf_Die *die, int *found)
+search_typedef(Dwarf_Die *die, int *found)
 {
-	int tag;
-	const char *name;
-
 	/*
 	 * If we get to here then we don't have any more
 	 * children, check to see if this is a relevant tag
 	 */
 	do {
-		tag  = dwarf_tag(die);
-		name = dwarf_diename(die);
-
-		if ((tag == DW_TAG_variable) && (name)
-		    && !strcmp(name, dwarf_info.symbol_name))
+		if (check_typedef(die, found))
 			break;
-
 	} while (!dwarf_siblingof(die, die));
+}
 
-	if ((tag != DW_TAG_variable) || (!name)
-	    || strcmp(name, dwarf_info.symbol_name)) {
-		/*
-		 * Not found the demanded symbol.
-		 */
-		return;
-	}
+/*
+ * Check whether the die is the demanded symbol.
+ * Return TRUE if the search can be stopped.
+ */
+static int
+check_symbol(Dwarf_Die *die, int *found)
+{
+	const char *name;
+
+	name = dwarf_diename(die);
+
+	if ((dwarf_tag(die) != DW_TAG_variable) || (!name)
+	    || strcmp(name, dwarf_info.symbol_name))
+		return FALSE;
 
 	/*
 	 * Found the demanded symbol.
@@ -834,18 +942,73 @@ search_symbol(Dwarf_Die *die, int *found)
 		get_dwarf_base_type(die);
 		break;
 	}
+	return TRUE;
+}
+
+static void
+search_symbol(Dwarf_Die *die, int *found)
+{
+	/*
+	 * If we get to here then we don't have any more
+	 * children, check to see if this is a relevant tag
+	 */
+	do {
+		if (check_symbol(die, found))
+			break;
+	} while (!dwarf_siblingof(die, die));
+}
+
+/*
+ * Check whether the die, whose name is the demanded one, is in the
+ * demanded domain.  Return TRUE if the search can be stopped.
+ */
+static int
+check_domain(Dwarf_Die *die, int *found)
+{
+	int tag;
+	short flag = 0;
+
+	tag = dwarf_tag(die);
+
+	switch (dwarf_info.cmd) {
+	case DWARF_INFO_GET_DOMAIN_STRUCT:
+		if (tag == DW_TAG_structure_type)
+			flag = 1;
+		break;
+	case DWARF_INFO_GET_DOMAIN_UNION:
+		if (tag == DW_TAG_union_type)
+			flag = 1;
+		break;
+	case DWARF_INFO_GET_DOMAIN_TYPEDEF:
+		if (tag == DW_TAG_typedef)
+			flag = 1;
+		break;
+	/* TODO
+	 * Implement functionality for the rest of the domains
+	 */
+	}
+
+	if (!flag)
+		return FALSE;
+
+	dwarf_info.struct_size = dwarf_bytesize(die);
+
+	if (dwarf_info.struct_size > 0) {
+		if (found)
+			*found = TRUE;
+		dwarf_info.die_offset = dwarf_dieoffset(die);
+		return TRUE;
+	}
+	return FALSE;
 }
 
 static void
 search_domain(Dwarf_Die *die, int *found)
 {
-	int tag;
 	const char *name;
-	short flag = 0;
 	Dwarf_Die die_type;
 
 	do {
-		tag  = dwarf_tag(die);
 		name = dwarf_diename(die);
 
 		/*
@@ -867,59 +1030,41 @@ search_domain(Dwarf_Die *die, int *found)
 				if (*found)
 					return;
 			}
-		}
-
-		if ((!name) || strcmp(name, dwarf_info.symbol_name))
 			continue;
-
-		switch (dwarf_info.cmd) {
-		case DWARF_INFO_GET_DOMAIN_STRUCT:
-			if (tag == DW_TAG_structure_type)
-				flag = 1;
-			break;
-		case DWARF_INFO_GET_DOMAIN_UNION:
-			if (tag == DW_TAG_union_type)
-				flag = 1;
-			break;
-		case DWARF_INFO_GET_DOMAIN_TYPEDEF:
-			if (tag == DW_TAG_typedef)
-				flag = 1;
-			break;
-		/* TODO
-		 * Implement functionality for the rest of the domains
-		 */
 		}
 
-		if (!flag)
-			continue;
-
-		dwarf_info.struct_size = dwarf_bytesize(die);
-
-		if (dwarf_info.struct_size > 0) {
-			if (found)
-				*found = TRUE;
-			dwarf_info.die_offset = dwarf_dieoffset(die);
+		if (check_domain(die, found))
 			break;
-		}
 	} while (!dwarf_siblingof(die, die));
 }
 
-static void
-search_die(Dwarf_Die *die, int *found)
+/*
+ * Check whether the die has the demanded name.
+ * Return TRUE if the search can be stopped.
+ */
+static int
+check_die(Dwarf_Die *die, int *found)
 {
 	const char *name;
 
-	do {
-		name = dwarf_diename(die);
+	name = dwarf_diename(die);
 
-		if ((!name) || strcmp(name, dwarf_info.symbol_name))
-			continue;
+	if ((!name) || strcmp(name, dwarf_info.symbol_name))
+		return FALSE;
 
-		if (found)
-			*found = TRUE;
+	if (found)
+		*found = TRUE;
 
-		dwarf_info.die_offset = dwarf_dieoffset(die);
-		return;
+	dwarf_info.die_offset = dwarf_dieoffset(die);
+	return TRUE;
+}
+
+static void
+search_die(Dwarf_Die *die, int *found)
+{
+	do {
+		if (check_die(die, found))
+			return;
 	} while (!dwarf_siblingof(die, die));
 }
 
@@ -956,10 +1101,12 @@ search_die_tree(Dwarf_Die *die, int *found)
 		search_die(die, found);
 }
 
+/*
+ * Call search() for the die of each CompileUnit until *done is set.
+ */
 static int
-get_debug_info(void)
+walk_debug_info(void (*search)(Dwarf_Die *die, int *done), int *done)
 {
-	int found = FALSE;
 	char *name = NULL;
 	size_t shstrndx, header_size;
 	uint8_t address_size, offset_size;
@@ -970,17 +1117,12 @@ get_debug_info(void)
 	GElf_Shdr scnhdr_mem, *scnhdr = NULL;
 	Dwarf_Die cu_die;
 
-	int ret = FALSE;
-
-	if (!init_dwarf_info())
-		return FALSE;
-
 	elfd = dwarf_info.elfd;
 	dwarfd = dwarf_info.dwarfd;
 
 	if (elf_getshdrstrndx(elfd, &shstrndx) < 0) {
 		ERRMSG("Can't get the section index of the string table.\n");
-		goto out;
+		return FALSE;
 	}
 
 	/*
@@ -994,7 +1136,7 @@ get_debug_info(void)
 	}
 	if (strcmp(name, ".debug_info")) {
 		ERRMSG("Can't get .debug_info section.\n");
-		goto out;
+		return FALSE;
 	}
 
 	/*
@@ -1005,177 +1147,404 @@ get_debug_info(void)
 		off += header_size;
 		if (dwarf_offdie(dwarfd, off, &cu_die) == NULL) {
 			ERRMSG("Can't get CU die.\n");
-			goto out;
+			return FALSE;
 		}
-		search_die_tree(&cu_die, &found);
-		if (found)
+		search(&cu_die, done);
+		if (*done)
 			break;
 		off = next_off;
 	}
-	ret = TRUE;
-out:
-	clean_dwfl_info();
+	return TRUE;
+}
 
-	return ret;
+static unsigned int
+hash_name(const char *name)
+{
+	unsigned int hash = 2166136261U;
+
+	while (*name)
+		hash = (hash ^ (unsigned char)*name++) * 16777619U;
+
+	return hash & (NAME_HASH_SIZE - 1);
 }
 
+static int
+add_name_entry(struct name_index *index, const char *name,
+	       unsigned long long value)
+{
+	struct name_entry *entry;
+
+	if (index->num_entry == index->max_entry) {
+		index->max_entry = index->max_entry ?
+				   index->max_entry * 2 : 4096;
+		entry = realloc(index->entry,
+				sizeof(struct name_entry) * index->max_entry);
+		if (!entry) {
+			ERRMSG("Can't allocate memory for the name index.\n");
+			return FALSE;
+		}
+		index->entry = entry;
+	}
+	entry = &index->entry[index->num_entry++];
+	entry->name  = name;
+	entry->value = value;
+	entry->hash  = hash_name(name);
+
+	return TRUE;
+}
 
 /*
- * External functions.
+ * Chain the entries into the hash buckets.  The entries are chained
+ * in the order they were added, so a lookup finds the same one as the
+ * sequential search would.
  */
-char *
-get_dwarf_module_name(void)
+static int
+link_name_index(struct name_index *index)
 {
-	return dwarf_info.module_name;
-}
+	unsigned int i;
+	struct name_entry *entry;
 
-void
-get_fileinfo_of_debuginfo(int *fd, char **name)
-{
-	*fd = dwarf_info.fd_debuginfo;
-	*name = dwarf_info.name_debuginfo;
+	index->bucket = calloc(NAME_HASH_SIZE, sizeof(unsigned int));
+	if (!index->bucket) {
+		ERRMSG("Can't allocate memory for the name index.\n");
+		return FALSE;
+	}
+
+	for (i = index->num_entry; i > 0; i--) {
+		entry = &index->entry[i - 1];
+		entry->next = index->bucket[entry->hash];
+		index->bucket[entry->hash] = i;
+	}
+	return TRUE;
 }
 
-unsigned long long
-get_symbol_addr(char *symname)
+/*
+ * Return the entry of the name following prev, or the first one if
+ * prev is NULL.
+ */
+static struct name_entry *
+lookup_name_entry(struct name_index *index, struct name_entry *prev,
+		  const char *name)
 {
-	int i;
-	unsigned long long symbol = NOT_FOUND_SYMBOL;
-	Elf *elfd = NULL;
-	GElf_Shdr shdr;
-	GElf_Sym sym;
-	Elf_Data *data = NULL;
-	Elf_Scn *scn = NULL;
-	char *sym_name = NULL;
+	unsigned int i;
+	struct name_entry *entry;
 
-	if (!init_dwarf_info())
-		return NOT_FOUND_SYMBOL;
+	if (prev)
+		i = prev->next;
+	else
+		i = index->bucket[hash_name(name)];
 
-	elfd = dwarf_info.elfd;
+	for (; i; i = entry->next) {
+		entry = &index->entry[i - 1];
+		if (!strcmp(entry->name, name))
+			return entry;
+	}
+	return NULL;
+}
 
-	while ((scn = elf_nextscn(elfd, scn)) != NULL) {
-		if (gelf_getshdr(scn, &shdr) == NULL) {
-			ERRMSG("Can't get section header.\n");
-			goto out;
+static void
+index_die(Dwarf_Die *die, int *error)
+{
+	const char *name;
+	Dwarf_Die child, *walker;
+
+	switch (dwarf_tag(die)) {
+	case DW_TAG_enumeration_type:
+		/*
+		 * Enumerators are indexed by their own names, and
+		 * point to the enumeration type.
+		 */
+		if (dwarf_child(die, &child) == 0) {
+			walker = &child;
+			do {
+				if (dwarf_tag(walker) != DW_TAG_enumerator)
+					continue;
+				name = dwarf_diename(walker);
+				if (name && !add_name_entry(&dwarf_index.die,
+						name, dwarf_dieoffset(die))) {
+					*error = TRUE;
+					return;
+				}
+			} while (!dwarf_siblingof(walker, walker));
 		}
-		if (shdr.sh_type == SHT_SYMTAB)
-			break;
-	}
-	if (!scn) {
-		ERRMSG("Can't find symbol table.\n");
-		goto out;
+		/* Fall through */
+	case DW_TAG_structure_type:
+	case DW_TAG_union_type:
+	case DW_TAG_typedef:
+	case DW_TAG_variable:
+	case DW_TAG_base_type:
+		name = dwarf_diename(die);
+		if (name && !add_name_entry(&dwarf_index.die, name,
+					    dwarf_dieoffset(die)))
+			*error = TRUE;
+		break;
 	}
+}
 
-	data = elf_getdata(scn, data);
+/*
+ * Index the same dies as search_die_tree() visits, in the same order.
+ */
+static void
+index_die_tree(Dwarf_Die *die, int *error)
+{
+	Dwarf_Die child;
 
-	if ((!data) || (data->d_size == 0)) {
-		ERRMSG("No data in symbol table.\n");
-		goto out;
+	if (dwarf_child(die, &child) == 0)
+		index_die_tree(&child, error);
+
+	do {
+		if (*error)
+			return;
+		index_die(die, error);
+	} while (!dwarf_siblingof(die, die));
+}
+
+static int
+build_die_index(void)
+{
+	int error = FALSE;
+
+	if (!walk_debug_info(index_die_tree, &error) || error
+	    || !link_name_index(&dwarf_index.die)) {
+		free_name_index(&dwarf_index.die);
+		return FALSE;
 	}
+	DEBUG_MSG("Indexed %u debuginfo entries of %s.\n",
+		  dwarf_index.die.num_entry, dwarf_info.module_name);
 
-	for (i = 0; i < (shdr.sh_size/shdr.sh_entsize); i++) {
-		if (gelf_getsym(data, i, &sym) == NULL) {
-			ERRMSG("Can't get symbol at index %d.\n", i);
-			goto out;
-		}
-		sym_name = elf_strptr(elfd, shdr.sh_link, sym.st_name);
+	return TRUE;
+}
 
-		if (sym_name == NULL)
+/*
+ * Search the indexed dies of the demanded name.
+ * Return FALSE if the die may not be indexed and the whole debuginfo
+ * needs to be searched.
+ */
+static int
+search_die_index(int *found)
+{
+	char *name;
+	Dwarf_Die die;
+	struct name_entry *entry = NULL;
+
+	if (is_search_structure(dwarf_info.cmd)
+	    || is_search_typedef(dwarf_info.cmd))
+		name = dwarf_info.struct_name;
+	else if (is_search_number(dwarf_info.cmd))
+		name = dwarf_info.enum_name;
+	else if (is_search_symbol(dwarf_info.cmd)
+		 || is_search_domain(dwarf_info.cmd)
+		 || is_search_die(dwarf_info.cmd))
+		name = dwarf_info.symbol_name;
+	else
+		return FALSE;
+
+	while ((entry = lookup_name_entry(&dwarf_index.die, entry, name))) {
+		if (!dwarf_offdie(dwarf_info.dwarfd, entry->value, &die))
 			continue;
 
-		if (!strcmp(sym_name, symname)) {
-			symbol = sym.st_value;
-			break;
-		}
+		if (is_search_structure(dwarf_info.cmd))
+			check_structure(&die, found);
+
+		else if (is_search_number(dwarf_info.cmd))
+			check_number(&die, found);
+
+		else if (is_search_symbol(dwarf_info.cmd))
+			check_symbol(&die, found);
+
+		else if (is_search_typedef(dwarf_info.cmd))
+			check_typedef(&die, found);
+
+		else if (is_search_domain(dwarf_info.cmd))
+			check_domain(&die, found);
+
+		else if (is_search_die(dwarf_info.cmd))
+			check_die(&die, found);
+
+		if (*found)
+			return TRUE;
 	}
-out:
-	clean_dwfl_info();
 
-	return symbol;
+	/*
+	 * Domains are searched in the members too, and any die can
+	 * be demanded by its name.  These are not indexed.
+	 */
+	if (is_search_domain(dwarf_info.cmd) || is_search_die(dwarf_info.cmd))
+		return FALSE;
+
+	return TRUE;
 }
 
-unsigned long
-get_next_symbol_addr(char *symname)
+static int
+get_debug_info(void)
+{
+	int found = FALSE;
+
+	if (!init_dwarf_info())
+		return FALSE;
+
+	if (!dwarf_index.die.bucket && !build_die_index())
+		return FALSE;
+
+	if (search_die_index(&found))
+		return TRUE;
+
+	return walk_debug_info(search_die_tree, &found);
+}
+
+static int
+compare_symbol_value(const void *a, const void *b)
+{
+	unsigned long long value_a = *(const unsigned long long *)a;
+	unsigned long long value_b = *(const unsigned long long *)b;
+
+	if (value_a < value_b)
+		return -1;
+	return value_a > value_b;
+}
+
+static int
+build_symbol_index(void)
 {
 	int i;
-	unsigned long symbol = NOT_FOUND_SYMBOL;
-	unsigned long next_symbol = NOT_FOUND_SYMBOL;
 	Elf *elfd = NULL;
 	GElf_Shdr shdr;
 	GElf_Sym sym;
 	Elf_Data *data = NULL;
 	Elf_Scn *scn = NULL;
 	char *sym_name = NULL;
-
-	if (!init_dwarf_info())
-		return NOT_FOUND_SYMBOL;
+	struct name_index *index = &dwarf_index.symbol;
 
 	elfd = dwarf_info.elfd;
 
 	while ((scn = elf_nextscn(elfd, scn)) != NULL) {
 		if (gelf_getshdr(scn, &shdr) == NULL) {
 			ERRMSG("Can't get section header.\n");
-			goto out;
+			return FALSE;
 		}
 		if (shdr.sh_type == SHT_SYMTAB)
 			break;
 	}
 	if (!scn) {
 		ERRMSG("Can't find symbol table.\n");
-		goto out;
+		return FALSE;
 	}
 
 	data = elf_getdata(scn, data);
 
 	if ((!data) || (data->d_size == 0)) {
 		ERRMSG("No data in symbol table.\n");
-		goto out;
+		return FALSE;
 	}
 
 	for (i = 0; i < (shdr.sh_size/shdr.sh_entsize); i++) {
 		if (gelf_getsym(data, i, &sym) == NULL) {
 			ERRMSG("Can't get symbol at index %d.\n", i);
-			goto out;
+			goto err_out;
 		}
 		sym_name = elf_strptr(elfd, shdr.sh_link, sym.st_name);
 
 		if (sym_name == NULL)
 			continue;
 
-		if (!strcmp(sym_name, symname)) {
-			symbol = sym.st_value;
-			break;
-		}
+		if (!add_name_entry(index, sym_name, sym.st_value))
+			goto err_out;
+	}
+	if (!link_name_index(index))
+		goto err_out;
+
+	dwarf_index.symbol_value = malloc(sizeof(unsigned long long)
+					  * (index->num_entry + 1));
+	if (!dwarf_index.symbol_value) {
+		ERRMSG("Can't allocate memory for the symbol values.\n");
+		goto err_out;
 	}
+	for (i = 0; i < index->num_entry; i++)
+		dwarf_index.symbol_value[i] = index->entry[i].value;
+	qsort(dwarf_index.symbol_value, index->num_entry,
+	      sizeof(unsigned long long), compare_symbol_value);
+	dwarf_index.num_symbol_value = index->num_entry;
+
+	return TRUE;
+err_out:
+	free_name_index(index);
+
+	return FALSE;
+}
+
+/*
+ * Get the value of the first symbol of the name.
+ */
+static unsigned long long
+search_symbol_index(char *symname)
+{
+	struct name_entry *entry;
+
+	if (!dwarf_index.symbol.bucket && !build_symbol_index())
+		return NOT_FOUND_SYMBOL;
+
+	entry = lookup_name_entry(&dwarf_index.symbol, NULL, symname);
+	if (!entry)
+		return NOT_FOUND_SYMBOL;
+
+	return entry->value;
+}
+
+/*
+ * External functions.
+ */
+char *
+get_dwarf_module_name(void)
+{
+	return dwarf_info.module_name;
+}
+
+void
+get_fileinfo_of_debuginfo(int *fd, char **name)
+{
+	*fd = dwarf_info.fd_debuginfo;
+	*name = dwarf_info.name_debuginfo;
+}
+
+unsigned long long
+get_symbol_addr(char *symname)
+{
+	if (!init_dwarf_info())
+		return NOT_FOUND_SYMBOL;
+
+	return search_symbol_index(symname);
+}
+
+unsigned long
+get_next_symbol_addr(char *symname)
+{
+	unsigned long long symbol, *value;
+	unsigned int lo, hi, mid;
+
+	if (!init_dwarf_info())
+		return NOT_FOUND_SYMBOL;
 
+	symbol = search_symbol_index(symname);
 	if (symbol == NOT_FOUND_SYMBOL)
-		goto out;
+		return NOT_FOUND_SYMBOL;
 
 	/*
 	 * Search for next symbol.
 	 */
-	for (i = 0; i < (shdr.sh_size/shdr.sh_entsize); i++) {
-		if (gelf_getsym(data, i, &sym) == NULL) {
-			ERRMSG("Can't get symbol at index %d.\n", i);
-			goto out;
-		}
-		sym_name = elf_strptr(elfd, shdr.sh_link, sym.st_name);
-
-		if (sym_name == NULL)
-			continue;
-
-		if (symbol < sym.st_value) {
-			if (next_symbol == NOT_FOUND_SYMBOL)
-				next_symbol = sym.st_value;
-
-			else if (sym.st_value < next_symbol)
-				next_symbol = sym.st_value;
-		}
+	value = dwarf_index.symbol_value;
+	lo = 0;
+	hi = dwarf_index.num_symbol_value;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (value[mid] <= symbol)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
-out:
-	clean_dwfl_info();
+	if (lo == dwarf_index.num_symbol_value)
+		return NOT_FOUND_SYMBOL;
 
-	return next_symbol;
+	return value[lo];
 }
 
 /*
@@ -1382,15 +1751,11 @@ get_die_nfields(unsigned long long die_off)
 
 	die = &result;
 	tag = dwarf_tag(die);
-	if (tag != DW_TAG_structure_type && tag != DW_TAG_union_type) {
-		clean_dwfl_info();
+	if (tag != DW_TAG_structure_type && tag != DW_TAG_union_type)
 		return -1;
-	}
 
-	if (dwarf_child(die, &child) != 0) {
-		clean_dwfl_info();
+	if (dwarf_child(die, &child) != 0)
 		return -1;
-	}
 
 	/* Find the number of fields in the structure */
 	die = &child;
@@ -1402,7 +1767,6 @@ get_die_nfields(unsigned long long die_off)
 			continue;
 	} while (!dwarf_siblingof(die, die));
 
-	clean_dwfl_info();
 	return nfields;
 }
 
@@ -1426,15 +1790,11 @@ get_die_member(unsigned long long die_off, int index, long *offset,
 
 	die = &result;
 	tag = dwarf_tag(die);
-	if (tag != DW_TAG_structure_type && tag != DW_TAG_union_type) {
-		clean_dwfl_info();
+	if (tag != DW_TAG_structure_type && tag != DW_TAG_union_type)
 		return -1;
-	}
 
-	if (dwarf_child(die, &child) != 0) {
-		clean_dwfl_info();
+	if (dwarf_child(die, &child) != 0)
 		return -1;
-	}
 
 	/* Find the correct field in the structure */
 	die = &child;
@@ -1450,7 +1810,6 @@ get_die_member(unsigned long long die_off, int index, long *offset,
 
 	if (nfields != index) {
 		ERRMSG("No member found at index %d.\n", index);
-		clean_dwfl_info();
 		return -1;
 	}
 
@@ -1482,7 +1841,6 @@ get_die_member(unsigned long long die_off, int index, long *offset,
 	 */
 	*nbits = *fbits = 0;
 
-	clean_dwfl_info();
 	if (size < 0)
 		return 0;
 	else
@@ -1505,14 +1863,11 @@ get_die_attr_type(unsigned long long die_off, int *type_flag,
 		return FALSE;
 	}
 
-	if (!get_die_type(&result, &result)) {
-		clean_dwfl_info();
+	if (!get_die_type(&result, &result))
 		return FALSE;
-	}
 
 	*die_attr_off = dwarf_dieoffset(&result);
 	*type_flag = dwarf_tag(&result);
-	clean_dwfl_info();
 	return TRUE;
 }
 
@@ -1546,7 +1901,6 @@ get_die_name(unsigned long long die_off)
 	diename = dwarf_diename(&result);
 	if (diename)
 		name = strdup(diename);
-	clean_dwfl_info();
 	return name;
 }
 
@@ -1601,7 +1955,6 @@ get_die_length(unsigned long long die_off, int flag)
 		size = dwarf_bytesize(&die_base);
 	}
 out:
-	clean_dwfl_info();
 	return size;
 }
 
@@ -1617,6 +1970,12 @@ set_dwarf_debuginfo(char *mod_name, char *os_release,
 	if (dwarf_info.module_name && !strcmp(dwarf_info.module_name, mod_name))
 		return TRUE;
 
+	if (dwarf_info.module_name
+			&& !strcmp(dwarf_info.module_name, "vmlinux"))
+		save_vmlinux_session();
+	else
+		clean_dwfl_info();
+
 	/* Switching to different module.
 	 *
 	 * Close the file descriptor if previous module is != kernel and
@@ -1642,6 +2001,9 @@ set_dwarf_debuginfo(char *mod_name, char *os_release,
 	dwarf_info.name_debuginfo = name_debuginfo;
 	dwarf_info.module_name = strdup(mod_name);
 
+	if (!strcmp(dwarf_info.module_name, "vmlinux") && vmlinux_session.dwfl)
+		restore_vmlinux_session();
+
 	if (!strcmp(dwarf_info.module_name, "vmlinux") ||
 		!strcmp(dwarf_info.module_name, "xen-syms"))
 		return TRUE;
@@ -1650,3 +2012,71 @@ set_dwarf_debuginfo(char *mod_name, char *os_release,
 	return search_module_debuginfo(os_release);
 }
 
+/*
+ * Close the debuginfo sessions and free their indexes.  They are set up
+ * again on the next query.
+ */
+void
+clean_dwarf_info(void)
+{
+	clean_dwfl_info();
+
+	if (vmlinux_session.dwfl) {
+		dwfl_end(vmlinux_session.dwfl);
+		free_dwarf_index(&vmlinux_session.index);
+		memset(&vmlinux_session, 0, sizeof(vmlinux_session));
+	}
+}
+
+/*
+ * Get the GNU build ID of the debuginfo file.
+ * Return the length of the build ID, or 0 if there is none.
+ */
+int
+get_debuginfo_build_id(unsigned char *build_id, int len)
+{
+	int ret = 0;
+	size_t off, name_off, desc_off;
+	Elf *elfd;
+	Elf_Scn *scn = NULL;
+	Elf_Data *data;
+	GElf_Shdr shdr;
+	GElf_Nhdr nhdr;
+
+	if (dwarf_info.fd_debuginfo < 0)
+		return 0;
+
+	if ((elfd = elf_begin(dwarf_info.fd_debuginfo,
+			      ELF_C_READ_MMAP, NULL)) == NULL) {
+		ERRMSG("Can't get first elf header of %s.\n",
+		    dwarf_info.name_debuginfo);
+		return 0;
+	}
+
+	while ((scn = elf_nextscn(elfd, scn)) != NULL) {
+		if (gelf_getshdr(scn, &shdr) == NULL)
+			break;
+		if (shdr.sh_type != SHT_NOTE)
+			continue;
+		if ((data = elf_getdata(scn, NULL)) == NULL)
+			continue;
+
+		off = 0;
+		while ((off = gelf_getnote(data, off, &nhdr, &name_off,
+					   &desc_off)) > 0) {
+			if (nhdr.n_type != NT_GNU_BUILD_ID
+			    || nhdr.n_namesz != sizeof(ELF_NOTE_GNU)
+			    || memcmp((char *)data->d_buf + name_off,
+				      ELF_NOTE_GNU, sizeof(ELF_NOTE_GNU)))
+				continue;
+
+			ret = MIN(nhdr.n_descsz, len);
+			memcpy(build_id, (char *)data->d_buf + desc_off, ret);
+			goto out;
+		}
+	}
+out:
+	elf_end(elfd);
+
+	return ret;
+}
@@ -80,6 +80,8 @@ char *get_die_name(unsigned long long die_off);
 unsigned long long get_die_offset(char *sysname);
 int get_die_length(unsigned long long die_off, int flag);
 int set_dwarf_debuginfo(char *mod_name, char *os_release, char *name_debuginfo, int fd_debuginfo);
+void clean_dwarf_info(void);
+int get_debuginfo_build_id(unsigned char *build_id, int len);
 
 #endif  /* DWARF_INFO_H */
 
@@ -2238,93 +2238,163 @@ process_eppic_file(char *name_config)
 	return TRUE;
 }
 
+/*
+ * Erased physical address ranges sorted by paddr.  The array is built
+ * once from the filter_info list and only counted is modified afterwards,
+ * atomically, so the page writers (including the compression threads)
+ * can look it up without any locking.
+ */
+struct filter_range {
+	unsigned long long	paddr;
+	unsigned long long	end;
+	unsigned long long	max_end; /* max end of this and preceding ranges */
+	long			size;
+	int			erase_info_idx;
+	int			size_idx;
+	int			erase_ch;
+	unsigned short		nullify;
+	char			counted; /* the size is added to erase_info */
+};
+
+static struct filter_range	*filter_range = NULL;
+static unsigned long		num_filter_range = 0;
+
+/*
+ * With --split and --num-threads, all the dumpfiles are filtered in one
+ * process. split_counted[] has num_split flags for each range, which mark
+ * the dumpfiles whose pages the range has been filtered in.
+ */
+static char			*split_counted = NULL;
+static int			num_split = 0;
+
 static void
-split_filter_info(struct filter_info *prev, unsigned long long next_paddr,
-						size_t size)
+free_filter_info_list(void)
 {
-	struct filter_info *new;
+	struct filter_info *prev, *fi = filter_info;
 
-	if ((new = calloc(1, sizeof(struct filter_info))) == NULL) {
-		ERRMSG("Can't allocate memory to split filter info\n");
-		return;
+	while (fi) {
+		prev = fi;
+		fi = fi->next;
+		free(prev);
 	}
-
-	/*
-	 * copy over existing data from prev node and only update fields
-	 * that differ. This approach will take care of copying over of any
-	 * future member addition to filter_info structure.
-	 */
-	*new = *prev;
-	new->paddr          = next_paddr;
-	new->size           = size;
-	prev->next          = new;
+	filter_info = NULL;
 }
 
-static void
-update_erase_info(struct filter_info *fi)
+/*
+ * Convert the sorted filter_info list into the filter_range array.
+ */
+static int
+build_filter_range(void)
 {
+	struct filter_info *fi;
+	struct filter_range *fr;
 	struct erase_info *ei;
+	unsigned long long max_end = 0;
+	unsigned long num = 0;
 
-	if (!fi->erase_info_idx)
-		return;
+	free(filter_range);
+	filter_range = NULL;
+	num_filter_range = 0;
 
-	ei = &erase_info[fi->erase_info_idx];
+	for (fi = filter_info; fi; fi = fi->next)
+		num++;
+	if (!num)
+		return TRUE;
 
-	if (!ei->sizes) {
-		/* First time, allocate sizes array */
-		ei->sizes = calloc(ei->num_sizes, sizeof(long));
+	if ((filter_range = calloc(num, sizeof(struct filter_range))) == NULL) {
+		ERRMSG("Can't allocate memory for filter ranges. %s\n",
+		    strerror(errno));
+		return FALSE;
+	}
+
+	for (fi = filter_info, fr = filter_range; fi; fi = fi->next, fr++) {
+		fr->paddr          = fi->paddr;
+		fr->end            = fi->paddr + fi->size;
+		fr->size           = fi->size;
+		fr->erase_info_idx = fi->erase_info_idx;
+		fr->size_idx       = fi->size_idx;
+		fr->erase_ch       = fi->erase_ch;
+		fr->nullify        = fi->nullify;
+
+		if (fr->end > max_end)
+			max_end = fr->end;
+		fr->max_end = max_end;
+
+		if (!fr->erase_info_idx)
+			continue;
+
+		/*
+		 * Allocate the sizes array now, the accounting in
+		 * update_erase_info() may run on several threads.
+		 */
+		ei = &erase_info[fr->erase_info_idx];
 		if (!ei->sizes) {
-			ERRMSG("Can't allocate memory for erase info sizes\n");
-			return;
+			ei->sizes = calloc(ei->num_sizes, sizeof(long));
+			if (!ei->sizes) {
+				ERRMSG("Can't allocate memory for erase info sizes\n");
+				return FALSE;
+			}
 		}
 	}
+	num_filter_range = num;
+
+	free_filter_info_list();
+
+	return TRUE;
+}
+
+static void
+add_erase_info_size(struct filter_range *fr)
+{
+	struct erase_info *ei;
+
+	ei = &erase_info[fr->erase_info_idx];
+
 	ei->erased = 1;
-	if (!fi->nullify)
-		ei->sizes[fi->size_idx] += fi->size;
+	if (!fr->nullify)
+		__atomic_fetch_add(&ei->sizes[fr->size_idx], fr->size,
+				   __ATOMIC_RELAXED);
 	else
-		ei->sizes[fi->size_idx] = -1;
+		ei->sizes[fr->size_idx] = -1;
 }
 
-static int
-extract_filter_info(unsigned long long start_paddr,
-			unsigned long long end_paddr,
-			struct filter_info *fl_info)
+static void
+update_erase_info(struct filter_range *fr, int split)
 {
-	struct filter_info *fi = filter_info;
-	struct filter_info *prev = NULL;
-	size_t size1, size2;
+	if (!fr->erase_info_idx)
+		return;
 
-	if (!fl_info)
-		return FALSE;
+	if (split_counted && split >= 0)
+		__atomic_store_n(&split_counted[(fr - filter_range) * num_split
+						+ split], 1, __ATOMIC_RELAXED);
 
-	while (fi) {
-		if ((fi->paddr >= start_paddr) && (fi->paddr < end_paddr)) {
-			size1 = end_paddr - fi->paddr;
-			if (fi->size <= size1)
-				break;
-			size2 = fi->size - size1;
-			fi->size = size1;
-			split_filter_info(fi, fi->paddr + size1, size2);
-			break;
-		}
-		prev = fi;
-		fi   = fi->next;
-	}
-	if (!fi)
-		return FALSE;
+	/*
+	 * A range may be filtered more than once, e.g. when PT_LOADs of
+	 * ELF output overlap, so count it only the first time.
+	 */
+	if (__atomic_exchange_n(&fr->counted, 1, __ATOMIC_RELAXED))
+		return;
 
-	*fl_info      = *fi;
-	fl_info->next = NULL;
+	add_erase_info_size(fr);
+}
 
-	/* Delete this node */
-	if (!prev)
-		filter_info = fi->next;
-	else
-		prev->next  = fi->next;
-	update_erase_info(fi);
-	free(fi);
+/*
+ * Return the index of the first range which may overlap with the
+ * physical addresses from paddr.
+ */
+static unsigned long
+search_filter_range(unsigned long long paddr)
+{
+	unsigned long lo = 0, hi = num_filter_range, mid;
 
-	return TRUE;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (filter_range[mid].max_end <= paddr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
 }
 
 /*
@@ -2364,22 +2434,25 @@ gather_filter_info(void)
 	clean_module_symbols();
 	set_dwarf_debuginfo("vmlinux", NULL,
 			    info->name_vmlinux, info->fd_vmlinux);
+
+	if (ret)
+		ret = build_filter_range();
+
 	return ret;
 }
 
 void
 clear_filter_info(void)
 {
-	struct filter_info *prev, *fi = filter_info;
 	int i;
 
-	/* Delete filter_info nodes that are left out. */
-	while (fi) {
-		prev = fi;
-		fi = fi->next;
-		free(prev);
-	}
-	filter_info = NULL;
+	free_filter_info_list();
+	free(filter_range);
+	filter_range = NULL;
+	num_filter_range = 0;
+	free(split_counted);
+	split_counted = NULL;
+	num_split = 0;
 
 	if (erase_info == NULL)
 		return;
@@ -2393,74 +2466,116 @@ clear_filter_info(void)
 }
 
 /*
- * Filter buffer if the physical address is in filter_info.
+ * Prepare to keep the erase information of each of num dumpfiles, which
+ * are filtered at the same time with filter_split_data_buffer().
+ */
+int
+prepare_split_erase_info(int num)
+{
+	free(split_counted);
+	split_counted = NULL;
+	num_split = 0;
+
+	if (!num_filter_range)
+		return TRUE;
+
+	if ((split_counted = calloc(num_filter_range, num)) == NULL) {
+		ERRMSG("Can't allocate memory for split erase info. %s\n",
+		    strerror(errno));
+		return FALSE;
+	}
+	num_split = num;
+
+	return TRUE;
+}
+
+/*
+ * Make erase_info that of the dumpfile split, i.e. of the ranges filtered
+ * in its pages, as the process writing only that dumpfile would have.
  */
 void
-filter_data_buffer(unsigned char *buf, unsigned long long paddr,
-					size_t size)
+set_split_erase_info(int split)
 {
-	struct filter_info fl_info;
-	unsigned char *buf_ptr;
+	unsigned long i;
+	int j;
 
-	while (extract_filter_info(paddr, paddr + size, &fl_info)) {
-		buf_ptr = buf + (fl_info.paddr - paddr);
-		if (fl_info.nullify)
-			memset(buf_ptr, 0, fl_info.size);
-		else
-			memset(buf_ptr, fl_info.erase_ch, fl_info.size);
+	if (!split_counted)
+		return;
+
+	for (i = 1; i < num_erase_info; i++) {
+		erase_info[i].erased = 0;
+		for (j = 0; erase_info[i].sizes && j < erase_info[i].num_sizes;
+		     j++)
+			erase_info[i].sizes[j] = 0;
+	}
+	for (i = 0; i < num_filter_range; i++) {
+		if (filter_range[i].erase_info_idx
+		    && split_counted[i * num_split + split])
+			add_erase_info_size(&filter_range[i]);
 	}
 }
 
 /*
- * Filter buffer if the physical address is in filter_info.
+ * Filter buffer if the physical address is in filter_range. The pages
+ * are of the dumpfile split of prepare_split_erase_info(), if any.
  */
 void
-filter_data_buffer_parallel(unsigned char *buf, unsigned long long paddr,
-					size_t size, pthread_mutex_t *mutex)
+filter_split_data_buffer(unsigned char *buf, unsigned long long paddr,
+			 size_t size, int split)
 {
-	struct filter_info fl_info;
-	unsigned char *buf_ptr;
-	int found = FALSE;
-
-	while (TRUE) {
-		pthread_mutex_lock(mutex);
-		found = extract_filter_info(paddr, paddr + size, &fl_info);
-		pthread_mutex_unlock(mutex);
-
-		if (found) {
-			buf_ptr = buf + (fl_info.paddr - paddr);
-			if (fl_info.nullify)
-				memset(buf_ptr, 0, fl_info.size);
-			else
-				memset(buf_ptr, fl_info.erase_ch, fl_info.size);
-		} else {
+	struct filter_range *fr;
+	unsigned long long start, end, end_paddr = paddr + size;
+	unsigned long i;
+
+	for (i = search_filter_range(paddr); i < num_filter_range; i++) {
+		fr = &filter_range[i];
+		if (fr->paddr >= end_paddr)
 			break;
-		}
+		if (fr->end <= paddr)
+			continue;
+
+		start = MAX(fr->paddr, paddr);
+		end   = MIN(fr->end, end_paddr);
+		if (fr->nullify)
+			memset(buf + (start - paddr), 0, end - start);
+		else
+			memset(buf + (start - paddr), fr->erase_ch, end - start);
+		update_erase_info(fr, split);
 	}
 }
 
+/*
+ * Filter buffer if the physical address is in filter_range.
+ */
+void
+filter_data_buffer(unsigned char *buf, unsigned long long paddr,
+					size_t size)
+{
+	filter_split_data_buffer(buf, paddr, size, -1);
+}
+
 unsigned long
 get_size_eraseinfo(void)
 {
 	unsigned long size_eraseinfo = 0;
 	char size_str[MAX_SIZE_STR_LEN];
 	struct erase_info *ei;
-	struct filter_info *fl_info = filter_info;
+	struct filter_range *fr;
+	unsigned long i;
 
-	while (fl_info) {
-
-		if (!fl_info->erase_info_idx)
+	for (i = 0; i < num_filter_range; i++) {
+		fr = &filter_range[i];
+		if (!fr->erase_info_idx)
 			continue;
-		ei = &erase_info[fl_info->erase_info_idx];
-		if (fl_info->nullify)
+		ei = &erase_info[fr->erase_info_idx];
+		if (fr->nullify)
 			sprintf(size_str, "nullify\n");
 		else
-			sprintf(size_str, "size %ld\n", fl_info->size);
+			sprintf(size_str, "size %ld\n", fr->size);
 
 		size_eraseinfo += strlen("erase ") +
 				strlen(ei->symbol_expr) + 1 +
 				strlen(size_str);
-		fl_info = fl_info->next;
 	}
 
 	return size_eraseinfo;
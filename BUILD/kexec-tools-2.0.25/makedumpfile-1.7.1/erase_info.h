@@ -60,8 +60,10 @@ extern unsigned long		num_erase_info;
 int gather_filter_info(void);
 void clear_filter_info(void);
 void filter_data_buffer(unsigned char *buf, unsigned long long paddr, size_t size);
-void filter_data_buffer_parallel(unsigned char *buf, unsigned long long paddr,
-					size_t size, pthread_mutex_t *mutex);
+int prepare_split_erase_info(int num);
+void set_split_erase_info(int split);
+void filter_split_data_buffer(unsigned char *buf, unsigned long long paddr,
+			      size_t size, int split);
 unsigned long get_size_eraseinfo(void);
 int update_filter_info_raw(unsigned long long, int, int);
 
@@ -13,6 +13,7 @@
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
  * GNU General Public License for more details.
  */
+#define _GNU_SOURCE	/* O_DIRECT */
 #include "makedumpfile.h"
 #include "print_info.h"
 #include "detect_cycle.h"
@@ -48,6 +49,10 @@ char filename_stdout[] = FILENAME_STDOUT;
 /* Cache statistics */
 static unsigned long long	cache_hit;
 static unsigned long long	cache_miss;
+static unsigned long long	vtop_cache_hit;
+static unsigned long long	vtop_cache_miss;
+static struct page_desc_cache	pd_cache;
+static struct mem_map_reader	mm_reader;
 
 static unsigned long long	write_bytes;
 
@@ -306,8 +311,8 @@ is_cache_page(unsigned long flags)
 static inline unsigned long
 calculate_len_buf_out(long page_size)
 {
-	unsigned long zlib, lzo, snappy, zstd;
-	zlib = lzo = snappy = zstd = 0;
+	unsigned long zlib, lzo, snappy, zstd, lz4;
+	zlib = lzo = snappy = zstd = lz4 = 0;
 
 	zlib = compressBound(page_size);
 #ifdef USELZO
@@ -319,120 +324,94 @@ calculate_len_buf_out(long page_size)
 #ifdef USEZSTD
 	zstd = ZSTD_compressBound(page_size);
 #endif
-	return MAX(zlib, MAX(lzo, MAX(snappy, zstd)));
+#ifdef USELZ4
+	lz4 = LZ4_compressBound(page_size);
+#endif
+	return MAX(zlib, MAX(lzo, MAX(snappy, MAX(zstd, lz4))));
 }
 
-#define BITMAP_SECT_LEN 4096
-static inline int is_dumpable(struct dump_bitmap *, mdf_pfn_t, struct cycle *cycle);
-unsigned long
-pfn_to_pos(mdf_pfn_t pfn)
-{
-	unsigned long desc_pos;
-	mdf_pfn_t i;
-
-	desc_pos = info->valid_pages[pfn / BITMAP_SECT_LEN];
-	for (i = round(pfn, BITMAP_SECT_LEN); i < pfn; i++)
-		if (is_dumpable(info->bitmap_memory, i, NULL))
-			desc_pos++;
-
-	return desc_pos;
-}
+/*
+ * info->valid_pages[] holds the number of dumpable pages before each
+ * RANK_BLOCK_BITS block of the 2nd bitmap of a kdump-compressed VMCORE.
+ * Then the position of a page descriptor is the rank of the pfn, which
+ * costs at most RANK_BLOCK_WORDS popcounts over the bitmap block read
+ * into bitmap->buf.
+ */
+#define RANK_BLOCK_BITS		512
+#define RANK_BLOCK_WORDS	(RANK_BLOCK_BITS / 64)
 
 unsigned long
-pfn_to_pos_parallel(mdf_pfn_t pfn, struct dump_bitmap* bitmap_memory_parallel)
-{
-	unsigned long desc_pos;
-	mdf_pfn_t i;
-
-	desc_pos = info->valid_pages[pfn / BITMAP_SECT_LEN];
-	for (i = round(pfn, BITMAP_SECT_LEN); i < pfn; i++)
-		if (is_dumpable(bitmap_memory_parallel, i, NULL))
-			desc_pos++;
-
-	return desc_pos;
-}
-
-int
-read_page_desc(unsigned long long paddr, page_desc_t *pd)
+pfn_to_pos(mdf_pfn_t pfn, struct dump_bitmap *bitmap)
 {
-	struct disk_dump_header *dh;
 	unsigned long desc_pos;
-	mdf_pfn_t pfn;
-	off_t offset;
+	unsigned char *block;
+	uint64_t word;
+	int i, bits;
 
 	/*
-	 * Find page descriptor
+	 * Read the bitmap block of pfn into bitmap->buf.
 	 */
-	dh = info->dh_memory;
-	offset
-	    = (DISKDUMP_HEADER_BLOCKS + dh->sub_hdr_size + dh->bitmap_blocks)
-		* dh->block_size;
-	pfn = paddr_to_pfn(paddr);
-	desc_pos = pfn_to_pos(pfn);
-	offset += (off_t)desc_pos * sizeof(page_desc_t);
-	if (lseek(info->fd_memory, offset, SEEK_SET) < 0) {
-		ERRMSG("Can't seek %s. %s\n",
-				 info->name_memory, strerror(errno));
-		return FALSE;
-	}
+	is_dumpable(bitmap, pfn, NULL);
 
-	/*
-	 * Read page descriptor
-	 */
-	if (read(info->fd_memory, pd, sizeof(*pd)) != sizeof(*pd)) {
-		ERRMSG("Can't read %s. %s\n",
-				info->name_memory, strerror(errno));
-		return FALSE;
+	desc_pos = info->valid_pages[pfn / RANK_BLOCK_BITS];
+	block = (unsigned char *)bitmap->buf
+		+ round(pfn % PFN_BUFBITMAP, RANK_BLOCK_BITS) / BITPERBYTE;
+	bits = pfn % RANK_BLOCK_BITS;
+	for (i = 0; i < bits / 64; i++) {
+		memcpy(&word, block + i * sizeof(word), sizeof(word));
+		desc_pos += __builtin_popcountll(word);
 	}
+	for (i *= sizeof(word); i < bits / BITPERBYTE; i++)
+		desc_pos += __builtin_popcount(block[i]);
+	if (bits % BITPERBYTE)
+		desc_pos += __builtin_popcount(block[i] &
+					       ((1 << (bits % BITPERBYTE)) - 1));
 
-	/*
-	 * Sanity check
-	 */
-	if (pd->size > dh->block_size)
-		return FALSE;
-
-	return TRUE;
+	return desc_pos;
 }
 
-int
-read_page_desc_parallel(int fd_memory, unsigned long long paddr,
-			page_desc_t *pd,
-			struct dump_bitmap* bitmap_memory_parallel)
+/*
+ * Read the page descriptor of paddr. The descriptors are read
+ * PAGE_DESC_CACHE_NUM at a time into pdc, because pages are mostly
+ * read in pfn order.
+ */
+static int
+read_page_desc(int fd_memory, struct page_desc_cache *pdc,
+	       struct dump_bitmap *bitmap, unsigned long long paddr,
+	       page_desc_t *pd)
 {
 	struct disk_dump_header *dh;
 	unsigned long desc_pos;
-	mdf_pfn_t pfn;
 	off_t offset;
+	ssize_t ret;
 
-	/*
-	 * Find page descriptor
-	 */
 	dh = info->dh_memory;
-	offset
-	    = (DISKDUMP_HEADER_BLOCKS + dh->sub_hdr_size + dh->bitmap_blocks)
-		* dh->block_size;
-	pfn = paddr_to_pfn(paddr);
-	desc_pos = pfn_to_pos_parallel(pfn, bitmap_memory_parallel);
-	offset += (off_t)desc_pos * sizeof(page_desc_t);
-	if (lseek(fd_memory, offset, SEEK_SET) < 0) {
-		ERRMSG("Can't seek %s. %s\n",
-				 info->name_memory, strerror(errno));
-		return FALSE;
-	}
-
-	/*
-	 * Read page descriptor
-	 */
-	if (read(fd_memory, pd, sizeof(*pd)) != sizeof(*pd)) {
-		ERRMSG("Can't read %s. %s\n",
-				info->name_memory, strerror(errno));
-		return FALSE;
+	desc_pos = pfn_to_pos(paddr_to_pfn(paddr), bitmap);
+
+	if (desc_pos < pdc->start || desc_pos >= pdc->start + pdc->num) {
+		offset = (DISKDUMP_HEADER_BLOCKS + dh->sub_hdr_size
+			  + dh->bitmap_blocks) * dh->block_size;
+		offset += (off_t)desc_pos * sizeof(page_desc_t);
+		ret = pread(fd_memory, pdc->pd,
+			    sizeof(page_desc_t) * PAGE_DESC_CACHE_NUM, offset);
+		if (ret < (ssize_t)sizeof(page_desc_t)) {
+			ERRMSG("Can't read %s. %s\n",
+			       info->name_memory, strerror(errno));
+			pdc->num = 0;
+			return FALSE;
+		}
+		pdc->start = desc_pos;
+		pdc->num = ret / sizeof(page_desc_t);
 	}
+	*pd = pdc->pd[desc_pos - pdc->start];
 
 	/*
 	 * Sanity check
 	 */
-	if (pd->size > dh->block_size)
+	if (pd->flags & DUMP_DH_EXTENT) {
+		if (pd->size > EXTENT_NR_PAGES(pd->page_flags) * dh->block_size)
+			return FALSE;
+	} else if (pd->size > dh->block_size)
 		return FALSE;
 
 	return TRUE;
@@ -594,9 +573,13 @@ mappage_elf(unsigned long long paddr)
 	return info->mmap_buf + (offset - info->mmap_start_offset);
 }
 
+/*
+ * Map the pages [paddr, paddr + size) if they are contiguous in
+ * the same PT_LOAD segment of the dump memory.
+ */
 static char *
 mappage_elf_parallel(int fd_memory, unsigned long long paddr,
-		     struct mmap_cache *mmap_cache)
+		     unsigned long size, struct mmap_cache *mmap_cache)
 {
 	off_t offset, offset2;
 	int flag_usemmap;
@@ -611,14 +594,18 @@ mappage_elf_parallel(int fd_memory, unsigned long long paddr,
 	if (!offset || page_is_fractional(offset))
 		return NULL;
 
-	offset2 = paddr_to_offset(paddr + info->page_size - 1);
+	offset2 = paddr_to_offset(paddr + size - 1);
 	if (!offset2)
 		return NULL;
 
-	if (offset2 - offset != info->page_size - 1)
+	if (offset2 - offset != size - 1)
+		return NULL;
+
+	if (offset_to_pt_load_end(offset) - offset < size)
 		return NULL;
 
-	if (!is_mapped_with_mmap_parallel(offset, mmap_cache) &&
+	if ((!is_mapped_with_mmap_parallel(offset, mmap_cache)
+	     || offset + size > mmap_cache->mmap_end_offset) &&
 	    !update_mmap_range_parallel(fd_memory, offset, mmap_cache)) {
 		ERRMSG("Can't read the dump memory(%s) with mmap().\n",
 		       info->name_memory);
@@ -636,7 +623,7 @@ mappage_elf_parallel(int fd_memory, unsigned long long paddr,
 	}
 
 	if (offset < mmap_cache->mmap_start_offset ||
-	    offset + info->page_size > mmap_cache->mmap_end_offset)
+	    offset + size > mmap_cache->mmap_end_offset)
 		return NULL;
 
 	return mmap_cache->mmap_buf + (offset - mmap_cache->mmap_start_offset);
@@ -666,23 +653,148 @@ static int
 read_from_vmcore_parallel(int fd_memory, off_t offset, void *bufptr,
 			  unsigned long size)
 {
-	const off_t failed = (off_t)-1;
-
-	if (lseek(fd_memory, offset, SEEK_SET) == failed) {
-		ERRMSG("Can't seek the dump memory(%s). (offset: %llx) %s\n",
+	if (pread(fd_memory, bufptr, size, offset) != size) {
+		ERRMSG("Can't read the dump memory(%s). (offset: %llx) %s\n",
 		       info->name_memory, (unsigned long long)offset, strerror(errno));
 		return FALSE;
 	}
 
-	if (read(fd_memory, bufptr, size) != size) {
-		ERRMSG("Can't read the dump memory(%s). %s\n",
-		       info->name_memory, strerror(errno));
+	return TRUE;
+}
+
+#ifdef USEURING
+/*
+ * Set up io_uring with the queue depth of --io-uring, and register
+ * the buffers if possible.
+ */
+static int
+initialize_uring_io(struct uring_io *io, struct iovec *iov, int nr_iov)
+{
+	int ret;
+
+	io->depth = info->io_uring_depth;
+	io->inflight = 0;
+	io->fixed = FALSE;
+
+	ret = io_uring_queue_init(io->depth, &io->ring, 0);
+	if (ret < 0) {
+		MSG("io_uring is unavailable. %s\n", strerror(-ret));
+		MSG("read()/write() will be used instead of io_uring.\n");
+		io->depth = 0;
+		return FALSE;
+	}
+
+	/*
+	 * Registering the buffers may fail by RLIMIT_MEMLOCK, and then
+	 * io_uring still works with the unregistered buffers.
+	 */
+	ret = io_uring_register_buffers(&io->ring, iov, nr_iov);
+	if (ret < 0)
+		DEBUG_MSG("Can't register the buffers to io_uring. %s\n",
+			  strerror(-ret));
+	else
+		io->fixed = TRUE;
+
+	return TRUE;
+}
+
+static void
+reap_uring_io(struct uring_io *io)
+{
+	struct io_uring_cqe *cqe;
+	struct uring_req *req;
+	int ret;
+
+	do {
+		ret = io_uring_wait_cqe(&io->ring, &cqe);
+	} while (ret == -EINTR);
+
+	if (ret < 0) {
+		/*
+		 * Give up the requests in flight. wait_uring_req() tells
+		 * the callers that they are unfinished.
+		 */
+		ERRMSG("Can't get a completion of io_uring. %s\n",
+		       strerror(-ret));
+		io->inflight = 0;
+		return;
+	}
+
+	req = io_uring_cqe_get_data(cqe);
+	req->res = cqe->res;
+	io_uring_cqe_seen(&io->ring, cqe);
+	io->inflight--;
+}
+
+/*
+ * Submit a read or write of req. buf_index is the index of the
+ * registered buffer which req->buf is in.
+ */
+static int
+submit_uring_req(struct uring_io *io, struct uring_req *req, int fd,
+		 int write, int buf_index)
+{
+	struct io_uring_sqe *sqe;
+	int ret;
+
+	while (io->inflight >= io->depth)
+		reap_uring_io(io);
+
+	if ((sqe = io_uring_get_sqe(&io->ring)) == NULL)
+		return FALSE;
+
+	if (write && io->fixed)
+		io_uring_prep_write_fixed(sqe, fd, req->buf, req->len,
+					  req->offset, buf_index);
+	else if (write)
+		io_uring_prep_write(sqe, fd, req->buf, req->len, req->offset);
+	else if (io->fixed)
+		io_uring_prep_read_fixed(sqe, fd, req->buf, req->len,
+					 req->offset, buf_index);
+	else
+		io_uring_prep_read(sqe, fd, req->buf, req->len, req->offset);
+	io_uring_sqe_set_data(sqe, req);
+
+	req->res = -EINPROGRESS;
+	ret = io_uring_submit(&io->ring);
+	if (ret < 0) {
+		ERRMSG("Can't submit to io_uring. %s\n", strerror(-ret));
+		req->res = ret;
 		return FALSE;
 	}
+	io->inflight++;
 
 	return TRUE;
 }
 
+static int
+wait_uring_req(struct uring_io *io, struct uring_req *req)
+{
+	while (req->res == -EINPROGRESS && io->inflight > 0)
+		reap_uring_io(io);
+
+	return req->res != -EINPROGRESS;
+}
+
+static void
+drain_uring_io(struct uring_io *io)
+{
+	while (io->inflight > 0)
+		reap_uring_io(io);
+}
+
+static void
+finalize_uring_io(struct uring_io *io)
+{
+	if (!io->depth)
+		return;
+
+	drain_uring_io(io);
+	io_uring_queue_exit(&io->ring);
+	io->depth = 0;
+}
+#endif /* USEURING */
+
 /*
  * This function is specific for reading page from ELF.
  *
@@ -814,230 +926,400 @@ readpage_elf_parallel(int fd_memory, unsigned long long paddr, void *bufptr)
 }
 
 static int
-readpage_kdump_compressed(unsigned long long paddr, void *bufptr)
+init_page_desc_cache(struct page_desc_cache *pdc)
 {
-	page_desc_t pd;
-	char *buf, *rdbuf;
-	int ret, out;
-	unsigned long retlen;
-
-	if (!is_dumpable(info->bitmap_memory, paddr_to_pfn(paddr), NULL)) {
-		ERRMSG("pfn(%llx) is excluded from %s.\n",
-				paddr_to_pfn(paddr), info->name_memory);
-		return FALSE;
-	}
-
-	if (!read_page_desc(paddr, &pd)) {
-		ERRMSG("Can't read page_desc: %llx\n", paddr);
-		return FALSE;
-	}
-
-	if (lseek(info->fd_memory, pd.offset, SEEK_SET) < 0) {
-		ERRMSG("Can't seek %s. %s\n",
-				info->name_memory, strerror(errno));
-		return FALSE;
-	}
+	if (pdc->pd)
+		return TRUE;
 
-	buf = malloc(info->page_size);
-	if (!buf) {
+	pdc->pd = malloc(sizeof(page_desc_t) * PAGE_DESC_CACHE_NUM);
+	pdc->buf = malloc(info->dh_memory->block_size * PAGE_READ_NUM);
+	if (!pdc->pd || !pdc->buf) {
 		ERRMSG("Cannot allocate buffer for decompression. %s\n",
 		       strerror(errno));
+		free_page_desc_cache(pdc);
 		return FALSE;
 	}
-	out = FALSE;
+	pdc->start = pdc->num = 0;
+	pdc->extent_nr = 0;
 
-	/*
-	 * Read page data
-	 */
-	rdbuf = pd.flags & (DUMP_DH_COMPRESSED_ZLIB | DUMP_DH_COMPRESSED_LZO |
-		DUMP_DH_COMPRESSED_SNAPPY | DUMP_DH_COMPRESSED_ZSTD) ? buf : bufptr;
-	if (read(info->fd_memory, rdbuf, pd.size) != pd.size) {
-		ERRMSG("Can't read %s. %s\n",
-				info->name_memory, strerror(errno));
-		goto out_error;
-	}
+	return TRUE;
+}
+
+void
+free_page_desc_cache(struct page_desc_cache *pdc)
+{
+	free(pdc->pd);
+	free(pdc->buf);
+	free(pdc->extent);
+	free(pdc->extent_cbuf);
+	pdc->pd = NULL;
+	pdc->buf = NULL;
+	pdc->extent = NULL;
+	pdc->extent_cbuf = NULL;
+	pdc->extent_len = pdc->extent_clen = pdc->extent_nr = 0;
+#ifdef USEZSTD
+	ZSTD_freeDCtx(pdc->zstd_dctx);
+	pdc->zstd_dctx = NULL;
+#endif
+}
 
-	if (pd.flags & DUMP_DH_COMPRESSED_ZLIB) {
-		retlen = info->page_size;
-		ret = uncompress((unsigned char *)bufptr, &retlen,
-					(unsigned char *)buf, pd.size);
-		if ((ret != Z_OK) || (retlen != info->page_size)) {
+/*
+ * Decompress size bytes of src, compressed as flags tells, into len
+ * bytes of dst. The decompression context of pdc is reused for every
+ * page decompressed through it.
+ */
+static int
+uncompress_buf(struct page_desc_cache *pdc, unsigned int flags, char *src,
+	       unsigned long size, void *dst, unsigned long len)
+{
+	int ret;
+	unsigned long retlen;
+
+	if (flags & DUMP_DH_COMPRESSED_ZLIB) {
+		retlen = len;
+		ret = uncompress((unsigned char *)dst, &retlen,
+					(unsigned char *)src, size);
+		if ((ret != Z_OK) || (retlen != len)) {
 			ERRMSG("Uncompress failed: %d\n", ret);
-			goto out_error;
+			return FALSE;
 		}
-	} else if ((pd.flags & DUMP_DH_COMPRESSED_LZO)) {
+	} else if ((flags & DUMP_DH_COMPRESSED_LZO)) {
 #ifdef USELZO
 		if (!info->flag_lzo_support) {
 			ERRMSG("lzo compression unsupported\n");
-			goto out_error;
+			return FALSE;
 		}
 
-		retlen = info->page_size;
-		ret = lzo1x_decompress_safe((unsigned char *)buf, pd.size,
-					    (unsigned char *)bufptr, &retlen,
+		retlen = len;
+		ret = lzo1x_decompress_safe((unsigned char *)src, size,
+					    (unsigned char *)dst, &retlen,
 					    LZO1X_MEM_DECOMPRESS);
-		if ((ret != LZO_E_OK) || (retlen != info->page_size)) {
+		if ((ret != LZO_E_OK) || (retlen != len)) {
 			ERRMSG("Uncompress failed: %d\n", ret);
-			goto out_error;
+			return FALSE;
 		}
 #else
 		ERRMSG("lzo compression unsupported\n");
 		ERRMSG("Try `make USELZO=on` when building.\n");
-		goto out_error;
+		return FALSE;
 #endif
-	} else if ((pd.flags & DUMP_DH_COMPRESSED_SNAPPY)) {
+	} else if ((flags & DUMP_DH_COMPRESSED_SNAPPY)) {
 #ifdef USESNAPPY
 
-		ret = snappy_uncompressed_length(buf, pd.size, (size_t *)&retlen);
-		if (ret != SNAPPY_OK) {
+		ret = snappy_uncompressed_length(src, size, (size_t *)&retlen);
+		if ((ret != SNAPPY_OK) || (retlen != len)) {
 			ERRMSG("Uncompress failed: %d\n", ret);
-			goto out_error;
+			return FALSE;
 		}
 
-		ret = snappy_uncompress(buf, pd.size, bufptr, (size_t *)&retlen);
-		if ((ret != SNAPPY_OK) || (retlen != info->page_size)) {
+		ret = snappy_uncompress(src, size, dst, (size_t *)&retlen);
+		if ((ret != SNAPPY_OK) || (retlen != len)) {
 			ERRMSG("Uncompress failed: %d\n", ret);
-			goto out_error;
+			return FALSE;
 		}
 #else
 		ERRMSG("snappy compression unsupported\n");
 		ERRMSG("Try `make USESNAPPY=on` when building.\n");
-		goto out_error;
+		return FALSE;
 #endif
-	} else if ((pd.flags & DUMP_DH_COMPRESSED_ZSTD)) {
+	} else if ((flags & DUMP_DH_COMPRESSED_ZSTD)) {
 #ifdef USEZSTD
-		ret = ZSTD_decompress(bufptr, info->page_size, buf, pd.size);
-		if (ZSTD_isError(ret) || (ret != info->page_size)) {
+		if (info->zstd_ddict) {
+			if (pdc->zstd_dctx == NULL
+			    && (pdc->zstd_dctx = ZSTD_createDCtx()) == NULL) {
+				ERRMSG("Can't allocate ZSTD_DCtx.\n");
+				return FALSE;
+			}
+			ret = ZSTD_decompress_usingDDict(pdc->zstd_dctx, dst,
+							 len, src, size,
+							 info->zstd_ddict);
+		} else
+			ret = ZSTD_decompress(dst, len, src, size);
+		if (ZSTD_isError(ret) || (ret != len)) {
 			ERRMSG("Uncompress failed: %d\n", ret);
-			goto out_error;
+			return FALSE;
 		}
 #else
 		ERRMSG("zstd compression unsupported\n");
 		ERRMSG("Try `make USEZSTD=on` when building.\n");
-		goto out_error;
+		return FALSE;
+#endif
+	} else if ((flags & DUMP_DH_COMPRESSED_LZ4)) {
+#ifdef USELZ4
+		ret = LZ4_decompress_safe(src, dst, size, len);
+		if (ret != len) {
+			ERRMSG("Uncompress failed: %d\n", ret);
+			return FALSE;
+		}
+#else
+		ERRMSG("lz4 compression unsupported\n");
+		ERRMSG("Try `make USELZ4=on` when building.\n");
+		return FALSE;
 #endif
+	} else if (src != dst)
+		memcpy(dst, src, size);
+
+	return TRUE;
+}
+
+/*
+ * Decompress the data src of the page described by pd into bufptr.
+ * An uncompressed page is copied unless it was read into bufptr.
+ * A filled page has no data, and is made from the value in pd.
+ */
+static int
+uncompress_page(struct page_desc_cache *pdc, page_desc_t *pd, char *src,
+		void *bufptr)
+{
+	unsigned long long val;
+	long i;
+
+	if (pd->flags & DUMP_DH_FILLED_PAGE) {
+		/*
+		 * Only a dumpfile marked in its header has filled pages.
+		 */
+		if (!(info->dh_memory->status & DUMP_DH_FILLED_PAGES)) {
+			ERRMSG("Invalid page_desc of a filled page.\n");
+			return FALSE;
+		}
+		val = pd->offset;
+		for (i = 0; i < info->page_size; i += sizeof(val))
+			memcpy((char *)bufptr + i, &val, sizeof(val));
+		return TRUE;
 	}
 
-	out = TRUE;
+	return uncompress_buf(pdc, pd->flags, src, pd->size, bufptr,
+			      info->page_size);
+}
 
-out_error:
-	free(buf);
-	return out;
+/*
+ * Copy a page of the frame described by pd into bufptr. The frame
+ * decompressed last is kept in pdc, so that the following pages of
+ * it are not read and decompressed again.
+ */
+static int
+read_extent_page(int fd_memory, struct page_desc_cache *pdc,
+		 page_desc_t *pd, void *bufptr)
+{
+	unsigned long nr, index, len;
+	char *p;
+
+	nr = EXTENT_NR_PAGES(pd->page_flags);
+	index = EXTENT_PAGE_INDEX(pd->page_flags);
+	if (index >= nr) {
+		ERRMSG("Invalid page_desc of a frame: %llx\n", pd->page_flags);
+		return FALSE;
+	}
+
+	if (!pdc->extent_nr || pdc->extent_offset != pd->offset
+	    || pdc->extent_nr != nr) {
+		len = nr * info->page_size;
+		if (pdc->extent_len < len) {
+			if ((p = realloc(pdc->extent, len)) == NULL)
+				goto nomem;
+			pdc->extent = p;
+			pdc->extent_len = len;
+		}
+		if (pdc->extent_clen < pd->size) {
+			if ((p = realloc(pdc->extent_cbuf, pd->size)) == NULL)
+				goto nomem;
+			pdc->extent_cbuf = p;
+			pdc->extent_clen = pd->size;
+		}
+		pdc->extent_nr = 0;
+
+		if (pread(fd_memory, pdc->extent_cbuf, pd->size, pd->offset)
+		    != pd->size) {
+			ERRMSG("Can't read %s. %s\n",
+			       info->name_memory, strerror(errno));
+			return FALSE;
+		}
+		if (!uncompress_buf(pdc, pd->flags, pdc->extent_cbuf, pd->size,
+				    pdc->extent, len))
+			return FALSE;
+
+		pdc->extent_offset = pd->offset;
+		pdc->extent_nr = nr;
+	}
+
+	memcpy(bufptr, pdc->extent + index * info->page_size, info->page_size);
+
+	return TRUE;
+nomem:
+	ERRMSG("Cannot allocate buffer for decompression. %s\n",
+	       strerror(errno));
+	return FALSE;
 }
 
+/*
+ * Read a page of a kdump-compressed VMCORE. The buffers of pdc are
+ * reused for every page read through it.
+ */
 static int
-readpage_kdump_compressed_parallel(int fd_memory, unsigned long long paddr,
-				   void *bufptr,
-				   struct dump_bitmap* bitmap_memory_parallel)
+readpage_kdump_compressed_fd(int fd_memory, struct page_desc_cache *pdc,
+			     struct dump_bitmap *bitmap,
+			     unsigned long long paddr, void *bufptr)
 {
 	page_desc_t pd;
-	char *buf, *rdbuf;
-	int ret, out;
-	unsigned long retlen;
+	char *rdbuf;
 
-	if (!is_dumpable(bitmap_memory_parallel, paddr_to_pfn(paddr), NULL)) {
+	if (!is_dumpable(bitmap, paddr_to_pfn(paddr), NULL)) {
 		ERRMSG("pfn(%llx) is excluded from %s.\n",
 				paddr_to_pfn(paddr), info->name_memory);
 		return FALSE;
 	}
 
-	if (!read_page_desc_parallel(fd_memory, paddr, &pd,
-						bitmap_memory_parallel)) {
+	if (!init_page_desc_cache(pdc))
+		return FALSE;
+
+	if (!read_page_desc(fd_memory, pdc, bitmap, paddr, &pd)) {
 		ERRMSG("Can't read page_desc: %llx\n", paddr);
 		return FALSE;
 	}
 
-	if (lseek(fd_memory, pd.offset, SEEK_SET) < 0) {
-		ERRMSG("Can't seek %s. %s\n",
+	if (pd.flags & DUMP_DH_FILLED_PAGE)
+		return uncompress_page(pdc, &pd, NULL, bufptr);
+	if (pd.flags & DUMP_DH_EXTENT)
+		return read_extent_page(fd_memory, pdc, &pd, bufptr);
+
+	/*
+	 * Read page data
+	 */
+	rdbuf = pd.flags & (DUMP_DH_COMPRESSED_ZLIB | DUMP_DH_COMPRESSED_LZO |
+		DUMP_DH_COMPRESSED_SNAPPY | DUMP_DH_COMPRESSED_ZSTD |
+		DUMP_DH_COMPRESSED_LZ4) ?
+		pdc->buf : bufptr;
+	if (pread(fd_memory, rdbuf, pd.size, pd.offset) != pd.size) {
+		ERRMSG("Can't read %s. %s\n",
 				info->name_memory, strerror(errno));
 		return FALSE;
 	}
 
-	buf = malloc(info->page_size);
-	if (!buf) {
-		ERRMSG("Cannot allocate buffer for decompression. %s\n",
-		       strerror(errno));
-		return FALSE;
-	}
-	out = FALSE;
+	return uncompress_page(pdc, &pd, rdbuf, bufptr);
+}
 
-	/*
-	 * Read page data
-	 */
-	rdbuf = pd.flags & (DUMP_DH_COMPRESSED_ZLIB | DUMP_DH_COMPRESSED_LZO |
-		DUMP_DH_COMPRESSED_SNAPPY | DUMP_DH_COMPRESSED_ZSTD) ? buf : bufptr;
-	if (read(fd_memory, rdbuf, pd.size) != pd.size) {
-		ERRMSG("Can't read %s. %s\n",
-				info->name_memory, strerror(errno));
-		goto out_error;
-	}
+/*
+ * Read the run of pfns [pfn, pfn + nr) of a kdump-compressed VMCORE.
+ * The descriptors of the run are consecutive, and so is the page data
+ * except where pages share the data of the zero page. Each stretch of
+ * consecutive data, up to PAGE_READ_NUM pages, is read with one pread()
+ * and then decompressed page by page.
+ */
+static int
+read_pfn_range_kdump_compressed(int fd_memory, struct page_desc_cache *pdc,
+				struct dump_bitmap *bitmap, mdf_pfn_t pfn,
+				mdf_pfn_t nr, unsigned char *buf)
+{
+	page_desc_t pd[PAGE_READ_NUM];
+	mdf_pfn_t i, j, n;
+	off_t offset = 0;
+	size_t size;
+	char *p;
 
-	if (pd.flags & DUMP_DH_COMPRESSED_ZLIB) {
-		retlen = info->page_size;
-		ret = uncompress((unsigned char *)bufptr, &retlen,
-					(unsigned char *)buf, pd.size);
-		if ((ret != Z_OK) || (retlen != info->page_size)) {
-			ERRMSG("Uncompress failed: %d\n", ret);
-			goto out_error;
-		}
-	} else if ((pd.flags & DUMP_DH_COMPRESSED_LZO)) {
-#ifdef USELZO
-		if (!info->flag_lzo_support) {
-			ERRMSG("lzo compression unsupported\n");
-			goto out_error;
-		}
+	if (!init_page_desc_cache(pdc))
+		return FALSE;
 
-		retlen = info->page_size;
-		ret = lzo1x_decompress_safe((unsigned char *)buf, pd.size,
-					    (unsigned char *)bufptr, &retlen,
-					    LZO1X_MEM_DECOMPRESS);
-		if ((ret != LZO_E_OK) || (retlen != info->page_size)) {
-			ERRMSG("Uncompress failed: %d\n", ret);
-			goto out_error;
+	for (i = 0; i < nr; i += n) {
+		size = 0;
+		for (n = 0; n < PAGE_READ_NUM && i + n < nr; n++) {
+			if (!is_dumpable(bitmap, pfn + i + n, NULL)) {
+				ERRMSG("pfn(%llx) is excluded from %s.\n",
+				       pfn + i + n, info->name_memory);
+				return FALSE;
+			}
+			if (!read_page_desc(fd_memory, pdc, bitmap,
+					    pfn_to_paddr(pfn + i + n), &pd[n])) {
+				ERRMSG("Can't read page_desc: %llx\n",
+				       pfn_to_paddr(pfn + i + n));
+				return FALSE;
+			}
+			/*
+			 * A filled page has no data, and a page of a frame
+			 * is copied from the frame. They are made alone.
+			 */
+			if (pd[n].flags & (DUMP_DH_FILLED_PAGE | DUMP_DH_EXTENT)) {
+				if (!n)
+					n++;
+				break;
+			}
+			if (n && pd[n].offset != offset + size)
+				break;
+			if (!n)
+				offset = pd[n].offset;
+			size += pd[n].size;
 		}
-#else
-		ERRMSG("lzo compression unsupported\n");
-		ERRMSG("Try `make USELZO=on` when building.\n");
-		goto out_error;
-#endif
-	} else if ((pd.flags & DUMP_DH_COMPRESSED_SNAPPY)) {
-#ifdef USESNAPPY
 
-		ret = snappy_uncompressed_length(buf, pd.size, (size_t *)&retlen);
-		if (ret != SNAPPY_OK) {
-			ERRMSG("Uncompress failed: %d\n", ret);
-			goto out_error;
+		if (pd[0].flags & DUMP_DH_FILLED_PAGE) {
+			if (!uncompress_page(pdc, &pd[0], NULL,
+					     buf + i * info->page_size))
+				return FALSE;
+			continue;
+		}
+		if (pd[0].flags & DUMP_DH_EXTENT) {
+			if (!read_extent_page(fd_memory, pdc, &pd[0],
+					      buf + i * info->page_size))
+				return FALSE;
+			continue;
 		}
 
-		ret = snappy_uncompress(buf, pd.size, bufptr, (size_t *)&retlen);
-		if ((ret != SNAPPY_OK) || (retlen != info->page_size)) {
-			ERRMSG("Uncompress failed: %d\n", ret);
-			goto out_error;
+		if (pread(fd_memory, pdc->buf, size, offset) != size) {
+			ERRMSG("Can't read %s. %s\n",
+			       info->name_memory, strerror(errno));
+			return FALSE;
 		}
-#else
-		ERRMSG("snappy compression unsupported\n");
-		ERRMSG("Try `make USESNAPPY=on` when building.\n");
-		goto out_error;
-#endif
-	} else if ((pd.flags & DUMP_DH_COMPRESSED_ZSTD)) {
-#ifdef USEZSTD
-		ret = ZSTD_decompress(bufptr, info->page_size, buf, pd.size);
-		if (ZSTD_isError(ret) || (ret != info->page_size)) {
-			ERRMSG("Uncompress failed: %d\n", ret);
-			goto out_error;
+		for (j = 0, p = pdc->buf; j < n; p += pd[j].size, j++) {
+			if (!uncompress_page(pdc, &pd[j], p,
+					     buf + (i + j) * info->page_size))
+				return FALSE;
 		}
-#else
-		ERRMSG("zstd compression unsupported\n");
-		ERRMSG("Try `make USEZSTD=on` when building.\n");
-		goto out_error;
-#endif
 	}
 
-	out = TRUE;
+	return TRUE;
+}
 
-out_error:
-	free(buf);
-	return out;
+static int
+readpage_kdump_compressed(unsigned long long paddr, void *bufptr)
+{
+	return readpage_kdump_compressed_fd(info->fd_memory, &pd_cache,
+					    info->bitmap_memory, paddr, bufptr);
+}
+
+static int
+readpage_kdump_compressed_parallel(int fd_memory, unsigned long long paddr,
+				   void *bufptr,
+				   struct dump_bitmap* bitmap_memory_parallel,
+				   struct page_desc_cache *pdc)
+{
+	return readpage_kdump_compressed_fd(fd_memory, pdc,
+					    bitmap_memory_parallel,
+					    paddr, bufptr);
+}
+
+
+/*
+ * Translate a virtual address through the translation cache, once the
+ * page tables and the addresses they depend on are settled by initial().
+ */
+static unsigned long long
+vaddr_to_paddr_cached(unsigned long long vaddr)
+{
+	unsigned long long paddr, size;
+
+	if (!info->flag_vtop_cache)
+		return vaddr_to_paddr(vaddr);
+
+	paddr = vtop_cache_search(vaddr);
+	if (paddr != NOT_PADDR) {
+		++vtop_cache_hit;
+		return paddr;
+	}
+	++vtop_cache_miss;
+
+	paddr = vaddr_to_paddr_size(vaddr, &size);
+	if (paddr != NOT_PADDR)
+		vtop_cache_add(vaddr, paddr, size);
+
+	return paddr;
 }
 
 int
@@ -1052,7 +1334,7 @@ readmem(int type_addr, unsigned long long addr, void *bufptr, size_t size)
 next_page:
 	switch (type_addr) {
 	case VADDR:
-		if ((paddr = vaddr_to_paddr(addr)) == NOT_PADDR) {
+		if ((paddr = vaddr_to_paddr_cached(addr)) == NOT_PADDR) {
 			ERRMSG("Can't convert a virtual address(%llx) to physical address.\n",
 			    addr);
 			goto error;
@@ -1133,6 +1415,158 @@ error:
 	return FALSE;
 }
 
+/*
+ * Set up a reader of mem_map. The buffer is allocated at the first
+ * time, and reused after that.
+ */
+static int
+init_mem_map_reader(struct mem_map_reader *reader, int direct, int fd_memory,
+		    pthread_mutex_t *vtop_mutex)
+{
+	if (!reader->buf) {
+		reader->buf = malloc(SIZE(page) * info->mem_map_batch);
+		if (!reader->buf) {
+			ERRMSG("Can't allocate the buffer of struct page. %s\n",
+			       strerror(errno));
+			return FALSE;
+		}
+		reader->mmap_cache.mmap_buf = MAP_FAILED;
+		reader->mmap_cache.mmap_start_offset = 0;
+		reader->mmap_cache.mmap_end_offset = 0;
+		reader->vtop_range.size = 0;
+	}
+	reader->direct = direct;
+	reader->fd_memory = fd_memory;
+	reader->vtop_mutex = vtop_mutex;
+
+	return TRUE;
+}
+
+void
+free_mem_map_reader(struct mem_map_reader *reader)
+{
+	struct mmap_cache *mc = &reader->mmap_cache;
+
+	if (!reader->buf)
+		return;
+
+	if (mc->mmap_buf != MAP_FAILED)
+		munmap(mc->mmap_buf, mc->mmap_end_offset - mc->mmap_start_offset);
+	free(reader->buf);
+	reader->buf = NULL;
+}
+
+/*
+ * Translate vaddr through the last mapping translated by the reader.
+ * The page tables are walked under vtop_mutex if it is shared.
+ */
+static unsigned long long
+mem_map_vtop(struct mem_map_reader *reader, unsigned long long vaddr)
+{
+	struct vtop_range *vr = &reader->vtop_range;
+	unsigned long long paddr, map_size;
+
+	if (vr->vaddr <= vaddr && vaddr < vr->vaddr + vr->size)
+		return vr->paddr + (vaddr - vr->vaddr);
+
+	if (reader->vtop_mutex)
+		pthread_mutex_lock(reader->vtop_mutex);
+	paddr = vaddr_to_paddr_size(vaddr, &map_size);
+	if (reader->vtop_mutex)
+		pthread_mutex_unlock(reader->vtop_mutex);
+
+	if (paddr == NOT_PADDR)
+		return NOT_PADDR;
+
+	vr->vaddr = vaddr & ~(map_size - 1);
+	vr->paddr = paddr & ~(map_size - 1);
+	vr->size = map_size;
+
+	return paddr;
+}
+
+/*
+ * Map [offset, offset + size) of the dump memory in the mmap window of
+ * the reader.
+ */
+static char *
+map_mem_map(struct mem_map_reader *reader, off_t offset, size_t size)
+{
+	struct mmap_cache *mc = &reader->mmap_cache;
+
+	if (info->flag_usemmap != MMAP_ENABLE)
+		return NULL;
+
+	if (mc->mmap_buf == MAP_FAILED || offset < mc->mmap_start_offset ||
+	    offset + size > mc->mmap_end_offset) {
+		if (!update_mmap_range_parallel(reader->fd_memory,
+						round(offset, info->page_size),
+						mc)) {
+			mc->mmap_buf = MAP_FAILED;
+			mc->mmap_start_offset = 0;
+			mc->mmap_end_offset = 0;
+			return NULL;
+		}
+		if (offset + size > mc->mmap_end_offset)
+			return NULL;
+	}
+
+	return mc->mmap_buf + (offset - mc->mmap_start_offset);
+}
+
+/*
+ * Return the struct pages at [vaddr, vaddr + size) of mem_map. They are
+ * used in place in the mmap window if they are contiguous in the dump
+ * memory, or read into the buffer of the reader.
+ */
+static unsigned char *
+read_mem_map(struct mem_map_reader *reader, unsigned long long vaddr,
+	     size_t size)
+{
+	unsigned long long paddr;
+	unsigned char *p = reader->buf;
+	size_t read_size;
+	char *mapbuf;
+	off_t offset;
+
+	if (!reader->direct)
+		return readmem(VADDR, vaddr, reader->buf, size) ? reader->buf : NULL;
+
+	while (size) {
+		paddr = mem_map_vtop(reader, vaddr);
+		if (paddr == NOT_PADDR) {
+			ERRMSG("Can't convert a virtual address(%llx) to physical address.\n",
+			    vaddr);
+			return NULL;
+		}
+		offset = paddr_to_offset(paddr);
+		if (!offset) {
+			ERRMSG("Can't convert a physical address(%llx) to offset.\n",
+			    paddr);
+			return NULL;
+		}
+		read_size = MIN(size, reader->vtop_range.vaddr
+				      + reader->vtop_range.size - vaddr);
+		read_size = MIN(read_size, offset_to_pt_load_end(offset) - offset);
+
+		mapbuf = map_mem_map(reader, offset, read_size);
+		if (mapbuf && p == reader->buf && read_size == size)
+			return (unsigned char *)mapbuf;
+
+		if (mapbuf)
+			memcpy(p, mapbuf, read_size);
+		else if (!read_from_vmcore_parallel(reader->fd_memory, offset,
+						    p, read_size))
+			return NULL;
+
+		p += read_size;
+		vaddr += read_size;
+		size -= read_size;
+	}
+
+	return reader->buf;
+}
+
 int32_t
 get_kernel_version(char *release)
 {
@@ -1321,6 +1755,52 @@ check_kdump_compressed(char *filename)
 	return TRUE;
 }
 
+#ifdef USEZSTD
+/*
+ * Load the dictionary of a dumpfile compressed with --zstd-dict once,
+ * for all the pages read from it.
+ */
+static int
+read_zstd_dict(char *filename, struct kdump_sub_header *kh)
+{
+	int fd = -1, ret = FALSE;
+	char *dict;
+
+	if ((dict = malloc(kh->size_zstd_dict)) == NULL) {
+		ERRMSG("Can't allocate memory for the zstd dictionary. %s\n",
+		       strerror(errno));
+		return FALSE;
+	}
+	if ((fd = open(filename, O_RDONLY)) < 0) {
+		ERRMSG("Can't open a file(%s). %s\n",
+		    filename, strerror(errno));
+		goto out;
+	}
+	if (pread(fd, dict, kh->size_zstd_dict, kh->offset_zstd_dict)
+	    != kh->size_zstd_dict) {
+		ERRMSG("Can't read a file(%s). %s\n",
+		    filename, strerror(errno));
+		goto out;
+	}
+
+	if (info->zstd_ddict)
+		ZSTD_freeDDict(info->zstd_ddict);
+	info->zstd_ddict = ZSTD_createDDict(dict, kh->size_zstd_dict);
+	if (info->zstd_ddict == NULL) {
+		ERRMSG("Can't create ZSTD_DDict.\n");
+		goto out;
+	}
+
+	ret = TRUE;
+out:
+	if (fd >= 0)
+		close(fd);
+	free(dict);
+
+	return ret;
+}
+#endif
+
 int
 get_kdump_compressed_header_info(char *filename)
 {
@@ -1332,6 +1812,10 @@ get_kdump_compressed_header_info(char *filename)
 
 	if (!read_kdump_sub_header(&kh, filename))
 		return FALSE;
+	if (dh.header_version < 7) {
+		kh.offset_zstd_dict = 0;
+		kh.size_zstd_dict = 0;
+	}
 
 	if (dh.header_version < 1) {
 		ERRMSG("header does not have dump_level member\n");
@@ -1402,6 +1886,16 @@ get_kdump_compressed_header_info(char *filename)
 				(unsigned long long)kh.offset_eraseinfo);
 		DEBUG_MSG("  size_eraseinfo   : 0x%ld\n", kh.size_eraseinfo);
 	}
+	if (dh.header_version >= 7) {
+		/* A dumpfile contains a zstd dictionary. */
+		DEBUG_MSG("  offset_zstd_dict : 0x%llx\n",
+				(unsigned long long)kh.offset_zstd_dict);
+		DEBUG_MSG("  size_zstd_dict   : 0x%ld\n", kh.size_zstd_dict);
+#ifdef USEZSTD
+		if (kh.size_zstd_dict && !read_zstd_dict(filename, &kh))
+			goto error;
+#endif
+	}
 	return TRUE;
 error:
 	free(info->dh_memory);
@@ -1438,6 +1932,43 @@ open_dump_memory(void)
 	return FALSE;
 }
 
+/*
+ * Get the alignment of the offset, the size and the buffer of the
+ * O_DIRECT I/O to fd, or 0 if the file does not support O_DIRECT.
+ * The file system tells it with statx(STATX_DIOALIGN) since Linux 6.1,
+ * and the block size of the file is taken otherwise.
+ */
+static size_t
+get_direct_io_align(int fd)
+{
+	struct stat st;
+	size_t align = 0;
+#ifdef STATX_DIOALIGN
+	struct statx stx;
+
+	if (statx(fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &stx) == 0
+	    && (stx.stx_mask & STATX_DIOALIGN)) {
+		if (!stx.stx_dio_offset_align)
+			return 0;
+		align = MAX(stx.stx_dio_offset_align, stx.stx_dio_mem_align);
+	}
+#endif
+	if (!align && fstat(fd, &st) == 0)
+		align = st.st_blksize;
+
+	/*
+	 * The alignments are powers of two, and so must be the alignment
+	 * of posix_memalign().
+	 */
+	if (!align || (align & (align - 1)))
+		align = info->page_size;
+	align = MAX(align, sizeof(void *));
+
+	DEBUG_MSG("O_DIRECT alignment of the dump file: %zu\n", align);
+
+	return align;
+}
+
 int
 open_dump_file(void)
 {
@@ -1459,6 +1990,29 @@ open_dump_file(void)
 		return FALSE;
 	}
 	info->fd_dumpfile = fd;
+
+	/*
+	 * With --direct-io, the data written through cache_data goes
+	 * to the dump file opened again with O_DIRECT.
+	 */
+	info->fd_dumpfile_direct = -1;
+	if (info->flag_direct_io && fd >= 0 && fd != STDOUT_FILENO
+	    && info->size_limit == -1) {
+		info->fd_dumpfile_direct = open(info->name_dumpfile,
+						O_RDWR|O_DIRECT);
+		if (info->fd_dumpfile_direct < 0)
+			MSG("Can't open the dump file(%s) with O_DIRECT, "
+			    "so '--direct-io' is ignored. %s\n",
+			    info->name_dumpfile, strerror(errno));
+	}
+	if (info->fd_dumpfile_direct >= 0
+	    && !(info->align_dumpfile_direct
+		 = get_direct_io_align(info->fd_dumpfile_direct))) {
+		MSG("The dump file(%s) does not support O_DIRECT, "
+		    "so '--direct-io' is ignored.\n", info->name_dumpfile);
+		close(info->fd_dumpfile_direct);
+		info->fd_dumpfile_direct = -1;
+	}
 	return TRUE;
 }
 
@@ -2505,14 +3059,187 @@ write_vmcoreinfo_data(void)
 	WRITE_SRCFILE("pud_t", pud_t);
 }
 
-int
-generate_vmcoreinfo(void)
+/*
+ * Read the debugging information from the debuginfo cache file, if it
+ * was made from the same vmlinux by the same makedumpfile.
+ */
+static int
+read_debuginfo_cache(unsigned char *build_id, int build_id_len)
 {
-	if (!set_page_size(sysconf(_SC_PAGE_SIZE)))
+	int fd, i, ret = FALSE;
+	char *map = MAP_FAILED, *p;
+	struct stat st;
+	struct debuginfo_cache_header *dch;
+	unsigned long long *symbol;
+	off_t size;
+
+	if ((fd = open(info->name_debuginfo_cache, O_RDONLY)) < 0)
 		return FALSE;
 
-	set_dwarf_debuginfo("vmlinux", NULL,
-			    info->name_vmlinux, info->fd_vmlinux);
+	if (fstat(fd, &st) < 0) {
+		ERRMSG("Can't get the size of %s. %s\n",
+		    info->name_debuginfo_cache, strerror(errno));
+		goto out;
+	}
+	size = sizeof(struct debuginfo_cache_header)
+		+ sizeof(symbol_table) + sizeof(size_table)
+		+ sizeof(offset_table) + sizeof(array_table)
+		+ sizeof(number_table) + sizeof(srcfile_table);
+	if (st.st_size != size)
+		goto stale;
+
+	map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		ERRMSG("Can't map %s. %s\n",
+		    info->name_debuginfo_cache, strerror(errno));
+		goto out;
+	}
+	dch = (struct debuginfo_cache_header *)map;
+
+	if (strncmp(dch->signature, DEBUGINFO_CACHE_SIGNATURE,
+		    SIG_LEN_DEBUGINFO_CACHE)
+	    || strncmp(dch->mdf_version, VERSION, sizeof(dch->mdf_version))
+	    || dch->version != VERSION_DEBUGINFO_CACHE
+	    || dch->build_id_len != build_id_len
+	    || memcmp(dch->build_id, build_id, build_id_len)
+	    || dch->size_symbol_table != sizeof(symbol_table)
+	    || dch->size_size_table != sizeof(size_table)
+	    || dch->size_offset_table != sizeof(offset_table)
+	    || dch->size_array_table != sizeof(array_table)
+	    || dch->size_number_table != sizeof(number_table)
+	    || dch->size_srcfile_table != sizeof(srcfile_table))
+		goto stale;
+
+	p = map + sizeof(struct debuginfo_cache_header);
+	memcpy(&symbol_table, p, sizeof(symbol_table));
+	p += sizeof(symbol_table);
+	memcpy(&size_table, p, sizeof(size_table));
+	p += sizeof(size_table);
+	memcpy(&offset_table, p, sizeof(offset_table));
+	p += sizeof(offset_table);
+	memcpy(&array_table, p, sizeof(array_table));
+	p += sizeof(array_table);
+	memcpy(&number_table, p, sizeof(number_table));
+	p += sizeof(number_table);
+	memcpy(&srcfile_table, p, sizeof(srcfile_table));
+
+	info->flag_use_count = dch->flag_use_count;
+	info->flag_use_printk_ringbuffer = dch->flag_use_printk_ringbuffer;
+	info->flag_use_printk_log = dch->flag_use_printk_log;
+
+	/*
+	 * The symbols are cached without the KASLR offset.
+	 */
+	symbol = (unsigned long long *)&symbol_table;
+	for (i = 0; i < sizeof(symbol_table) / sizeof(*symbol); i++) {
+		if (symbol[i] != NOT_FOUND_SYMBOL)
+			symbol[i] += info->kaslr_offset;
+	}
+
+	DEBUG_MSG("Read the debugging information from %s.\n",
+		  info->name_debuginfo_cache);
+	ret = TRUE;
+	goto out;
+stale:
+	DEBUG_MSG("%s is not made from %s.\n", info->name_debuginfo_cache,
+		  info->name_vmlinux);
+out:
+	if (map != MAP_FAILED)
+		munmap(map, size);
+	close(fd);
+
+	return ret;
+}
+
+static int
+write_debuginfo_cache(unsigned char *build_id, int build_id_len)
+{
+	int fd, i, ret = FALSE;
+	struct debuginfo_cache_header dch;
+	struct symbol_table symbol_cache;
+	unsigned long long *symbol;
+	struct {
+		void	*buf;
+		size_t	size;
+	} data[] = {
+		{ &dch,			sizeof(dch) },
+		{ &symbol_cache,	sizeof(symbol_cache) },
+		{ &size_table,		sizeof(size_table) },
+		{ &offset_table,	sizeof(offset_table) },
+		{ &array_table,		sizeof(array_table) },
+		{ &number_table,	sizeof(number_table) },
+		{ &srcfile_table,	sizeof(srcfile_table) },
+	};
+
+	memset(&dch, 0, sizeof(dch));
+	memcpy(dch.signature, DEBUGINFO_CACHE_SIGNATURE,
+	       SIG_LEN_DEBUGINFO_CACHE);
+	strncpy(dch.mdf_version, VERSION, sizeof(dch.mdf_version) - 1);
+	dch.version = VERSION_DEBUGINFO_CACHE;
+	dch.build_id_len = build_id_len;
+	memcpy(dch.build_id, build_id, build_id_len);
+	dch.size_symbol_table = sizeof(symbol_table);
+	dch.size_size_table = sizeof(size_table);
+	dch.size_offset_table = sizeof(offset_table);
+	dch.size_array_table = sizeof(array_table);
+	dch.size_number_table = sizeof(number_table);
+	dch.size_srcfile_table = sizeof(srcfile_table);
+	dch.flag_use_count = info->flag_use_count;
+	dch.flag_use_printk_ringbuffer = info->flag_use_printk_ringbuffer;
+	dch.flag_use_printk_log = info->flag_use_printk_log;
+
+	symbol_cache = symbol_table;
+	symbol = (unsigned long long *)&symbol_cache;
+	for (i = 0; i < sizeof(symbol_cache) / sizeof(*symbol); i++) {
+		if (symbol[i] != NOT_FOUND_SYMBOL)
+			symbol[i] -= info->kaslr_offset;
+	}
+
+	if ((fd = open(info->name_debuginfo_cache, O_WRONLY|O_CREAT|O_TRUNC,
+		       S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH)) < 0) {
+		ERRMSG("Can't open the debuginfo cache(%s). %s\n",
+		    info->name_debuginfo_cache, strerror(errno));
+		return FALSE;
+	}
+	for (i = 0; i < sizeof(data) / sizeof(data[0]); i++) {
+		if (write(fd, data[i].buf, data[i].size) != data[i].size) {
+			ERRMSG("Can't write the debuginfo cache(%s). %s\n",
+			    info->name_debuginfo_cache, strerror(errno));
+			goto out;
+		}
+	}
+	ret = TRUE;
+out:
+	if (close(fd) < 0) {
+		ERRMSG("Can't close the debuginfo cache(%s). %s\n",
+		    info->name_debuginfo_cache, strerror(errno));
+		ret = FALSE;
+	}
+	if (!ret)
+		unlink(info->name_debuginfo_cache);
+
+	return ret;
+}
+
+/*
+ * Get the symbol, structure and source file information of vmlinux.
+ * With --debuginfo-cache, they are read from the cache file if it is
+ * up to date, and the cache file is written otherwise.
+ */
+static int
+get_debuginfo_tables(void)
+{
+	unsigned char build_id[BUILD_ID_MAX];
+	int build_id_len = 0;
+
+	if (info->name_debuginfo_cache) {
+		build_id_len = get_debuginfo_build_id(build_id, BUILD_ID_MAX);
+		if (!build_id_len)
+			MSG("%s has no build ID, the debuginfo cache is not used.\n",
+			    info->name_vmlinux);
+		else if (read_debuginfo_cache(build_id, build_id_len))
+			return TRUE;
+	}
 
 	if (!get_symbol_info())
 		return FALSE;
@@ -2523,9 +3250,30 @@ generate_vmcoreinfo(void)
 	if (!get_srcfile_info())
 		return FALSE;
 
-	if ((SYMBOL(system_utsname) == NOT_FOUND_SYMBOL)
-	    && (SYMBOL(init_uts_ns) == NOT_FOUND_SYMBOL)) {
-		ERRMSG("Can't get the symbol of system_utsname.\n");
+	/*
+	 * Failing to write the cache does not prevent this run.
+	 */
+	if (build_id_len)
+		write_debuginfo_cache(build_id, build_id_len);
+
+	return TRUE;
+}
+
+int
+generate_vmcoreinfo(void)
+{
+	if (!set_page_size(sysconf(_SC_PAGE_SIZE)))
+		return FALSE;
+
+	set_dwarf_debuginfo("vmlinux", NULL,
+			    info->name_vmlinux, info->fd_vmlinux);
+
+	if (!get_debuginfo_tables())
+		return FALSE;
+
+	if ((SYMBOL(system_utsname) == NOT_FOUND_SYMBOL)
+	    && (SYMBOL(init_uts_ns) == NOT_FOUND_SYMBOL)) {
+		ERRMSG("Can't get the symbol of system_utsname.\n");
 		return FALSE;
 	}
 	if (!get_str_osrelease_from_vmlinux())
@@ -3890,8 +4638,10 @@ initialize_bitmap_memory(void)
 	struct dump_bitmap *bmp;
 	off_t bitmap_offset;
 	off_t bitmap_len, max_sect_len;
-	mdf_pfn_t pfn;
-	int i, j;
+	mdf_pfn_t max_mapnr;
+	unsigned long i, j, k;
+	uint64_t word;
+	size_t len;
 	long block_size;
 
 	dh = info->dh_memory;
@@ -3922,9 +4672,10 @@ initialize_bitmap_memory(void)
 	info->bitmap_memory = bmp;
 
 	if (dh->header_version >= 6)
-		max_sect_len = divideup(kh->max_mapnr_64, BITMAP_SECT_LEN);
+		max_mapnr = kh->max_mapnr_64;
 	else
-		max_sect_len = divideup(dh->max_mapnr, BITMAP_SECT_LEN);
+		max_mapnr = dh->max_mapnr;
+	max_sect_len = divideup(max_mapnr, RANK_BLOCK_BITS);
 	info->valid_pages = calloc(sizeof(ulong), max_sect_len);
 	if (info->valid_pages == NULL) {
 		ERRMSG("Can't allocate memory for the valid_pages. %s\n",
@@ -3933,12 +4684,33 @@ initialize_bitmap_memory(void)
 		free(bmp);
 		return FALSE;
 	}
-	for (i = 1, pfn = 0; i < max_sect_len; i++) {
-		info->valid_pages[i] = info->valid_pages[i - 1];
-		for (j = 0; j < BITMAP_SECT_LEN; j++, pfn++)
-			if (is_dumpable(info->bitmap_memory, pfn, NULL))
-				info->valid_pages[i]++;
+
+	/*
+	 * Count the dumpable pages of each RANK_BLOCK_BITS block, reading
+	 * the 2nd bitmap through bmp->buf.
+	 */
+	len = MIN(divideup(max_mapnr, BITPERBYTE), bitmap_len / 2);
+	for (i = 0; i < len; i += BUFSIZE_BITMAP) {
+		size_t size = MIN(BUFSIZE_BITMAP, len - i);
+
+		memset(bmp->buf, 0, BUFSIZE_BITMAP);
+		if (pread(info->fd_memory, bmp->buf, size, bmp->offset + i)
+		    != size) {
+			ERRMSG("Can't read the bitmap(%s). %s\n",
+			    info->name_memory, strerror(errno));
+			return FALSE;
+		}
+		for (j = 0; j < size; j += sizeof(word)) {
+			k = (i + j) / (RANK_BLOCK_BITS / BITPERBYTE) + 1;
+			if (k >= max_sect_len)
+				break;
+			memcpy(&word, bmp->buf + j, sizeof(word));
+			info->valid_pages[k] += __builtin_popcountll(word);
+		}
 	}
+	for (i = 1; i < max_sect_len; i++)
+		info->valid_pages[i] += info->valid_pages[i - 1];
+	bmp->no_block = -1;
 
 	return TRUE;
 }
@@ -3970,8 +4742,12 @@ initial_for_parallel()
 {
 	unsigned long len_buf_out;
 	unsigned long page_data_buf_size;
-	struct page_flag *current;
-	int i, j;
+	unsigned long buf_size;
+#ifdef USEURING
+	struct iovec iov;
+	int use_uring = info->io_uring_depth != 0;
+#endif
+	int i;
 
 	len_buf_out = calculate_len_buf_out(info->page_size);
 
@@ -4002,18 +4778,19 @@ initial_for_parallel()
 			return FALSE;
 		}
 
-		if ((BUF_PARALLEL(i) = malloc(info->page_size)) == NULL) {
+		/*
+		 * With io_uring, the next batch is read into the second
+		 * half while the first half is processed.
+		 */
+		buf_size = PFN_PER_BATCH * info->page_size;
+		if (info->io_uring_depth)
+			buf_size *= 2;
+		if ((BUF_PARALLEL(i) = malloc(buf_size)) == NULL) {
 			MSG("Can't allocate memory for the memory buffer. %s\n",
 					strerror(errno));
 			return FALSE;
 		}
 
-		if ((BUF_OUT_PARALLEL(i) = malloc(len_buf_out)) == NULL) {
-			MSG("Can't allocate memory for the compression buffer. %s\n",
-					strerror(errno));
-			return FALSE;
-		}
-
 		if ((MMAP_CACHE_PARALLEL(i) = malloc(sizeof(struct mmap_cache))) == NULL) {
 			MSG("Can't allocate memory for mmap_cache. %s\n",
 					strerror(errno));
@@ -4044,6 +4821,18 @@ initial_for_parallel()
 			MSG("Can't allocate ZSTD_CCtx.\n");
 			return FALSE;
 		}
+#endif
+#ifdef USEURING
+		/*
+		 * If io_uring is unavailable, the rest of the threads
+		 * read without it too.
+		 */
+		if (use_uring) {
+			iov.iov_base = BUF_PARALLEL(i);
+			iov.iov_len  = buf_size;
+			use_uring = initialize_uring_io(&URING_IO_PARALLEL(i),
+							&iov, 1);
+		}
 #endif
 	}
 
@@ -4070,33 +4859,40 @@ initial_for_parallel()
 	}
 
 	/*
-	 * initial page_flag for each thread
+	 * allocate memory for the page writers, one for each dumpfile
+	 * of --split, and their reorder buffers of page batches
 	 */
-	if ((info->page_flag_buf = malloc(sizeof(void *) * info->num_threads))
-	    == NULL) {
-		MSG("Can't allocate memory for page_flag_buf. %s\n",
+	info->num_page_writer = info->flag_split ? info->num_dumpfile : 1;
+	if ((info->page_writer = calloc(info->num_page_writer,
+					sizeof(struct page_writer))) == NULL) {
+		MSG("Can't allocate memory for page_writer. %s\n",
 				strerror(errno));
 		return FALSE;
 	}
-	memset(info->page_flag_buf, 0, sizeof(void *) * info->num_threads);
 
-	for (i = 0; i < info->num_threads; i++) {
-		if ((info->page_flag_buf[i] = calloc(1, sizeof(struct page_flag))) == NULL) {
-			MSG("Can't allocate memory for page_flag. %s\n",
-				strerror(errno));
+	for (i = 0; i < info->num_page_writer; i++) {
+		struct page_writer *pw = &info->page_writer[i];
+
+		pw->fd_memory = pw->fd_bitmap_memory = -1;
+		pw->mmap_cache.mmap_buf = MAP_FAILED;
+		if (!info->flag_dedup)
+			continue;
+		if ((pw->fd_memory = open(info->name_memory, O_RDONLY)) < 0
+		    || (pw->fd_bitmap_memory = open(info->name_memory,
+						    O_RDONLY)) < 0) {
+			ERRMSG("Can't open the dump memory(%s). %s\n",
+					info->name_memory, strerror(errno));
 			return FALSE;
 		}
-		current = info->page_flag_buf[i];
+	}
 
-		for (j = 1; j < PAGE_FLAG_NUM; j++) {
-			if ((current->next = calloc(1, sizeof(struct page_flag))) == NULL) {
-				MSG("Can't allocate memory for page_flag. %s\n",
-					strerror(errno));
-				return FALSE;
-			}
-			current = current->next;
-		}
-		current->next = info->page_flag_buf[i];
+	info->num_page_batch = PAGE_BATCH_NUM * info->num_threads;
+	if ((info->page_batch = calloc(info->num_page_batch
+				       * info->num_page_writer,
+				       sizeof(struct page_batch))) == NULL) {
+		MSG("Can't allocate memory for page_batch. %s\n",
+				strerror(errno));
+		return FALSE;
 	}
 
 	/*
@@ -4124,20 +4920,19 @@ initial_for_parallel()
 void
 free_for_parallel()
 {
-	int i, j;
-	struct page_flag *current;
+	int i;
 
 	if (info->threads != NULL) {
 		for (i = 0; i < info->num_threads; i++) {
 			if (info->threads[i] != NULL)
 				free(info->threads[i]);
 
+#ifdef USEURING
+			finalize_uring_io(&URING_IO_PARALLEL(i));
+#endif
 			if (BUF_PARALLEL(i) != NULL)
 				free(BUF_PARALLEL(i));
 
-			if (BUF_OUT_PARALLEL(i) != NULL)
-				free(BUF_OUT_PARALLEL(i));
-
 			if (MMAP_CACHE_PARALLEL(i) != NULL) {
 				if (MMAP_CACHE_PARALLEL(i)->mmap_buf !=
 								MAP_FAILED)
@@ -4147,6 +4942,8 @@ free_for_parallel()
 
 				free(MMAP_CACHE_PARALLEL(i));
 			}
+			free_page_desc_cache(&PAGE_DESC_CACHE_PARALLEL(i));
+			free_mem_map_reader(&MEM_MAP_READER_PARALLEL(i));
 			finalize_zlib(&ZLIB_STREAM_PARALLEL(i));
 #ifdef USELZO
 			if (WRKMEM_PARALLEL(i) != NULL)
@@ -4172,17 +4969,24 @@ free_for_parallel()
 		free(info->page_data_buf);
 	}
 
-	if (info->page_flag_buf != NULL) {
-		for (i = 0; i < info->num_threads; i++) {
-			for (j = 0; j < PAGE_FLAG_NUM; j++) {
-				if (info->page_flag_buf[i] != NULL) {
-					current = info->page_flag_buf[i];
-					info->page_flag_buf[i] = current->next;
-					free(current);
-				}
-			}
+	if (info->page_batch != NULL)
+		free(info->page_batch);
+
+	if (info->page_writer != NULL) {
+		for (i = 0; i < info->num_page_writer; i++) {
+			struct page_writer *pw = &info->page_writer[i];
+
+			if (pw->fd_memory >= 0)
+				close(pw->fd_memory);
+			if (pw->fd_bitmap_memory >= 0)
+				close(pw->fd_bitmap_memory);
+			if (pw->mmap_cache.mmap_buf != MAP_FAILED)
+				munmap(pw->mmap_cache.mmap_buf,
+				       pw->mmap_cache.mmap_end_offset
+				       - pw->mmap_cache.mmap_start_offset);
+			free_page_desc_cache(&pw->page_desc_cache);
 		}
-		free(info->page_flag_buf);
+		free(info->page_writer);
 	}
 
 	if (info->parallel_info == NULL)
@@ -4337,6 +5141,23 @@ initial(void)
 	}
 #endif
 
+#ifndef USELZ4
+	if (info->flag_compress == DUMP_DH_COMPRESSED_LZ4) {
+		MSG("'--lz4' option is disabled, ");
+		MSG("because this binary doesn't support lz4 compression.\n");
+		MSG("Try `make USELZ4=on` when building.\n");
+	}
+#endif
+
+#ifndef USEURING
+	if (info->io_uring_depth) {
+		MSG("'--io-uring' option is disabled, ");
+		MSG("because this binary doesn't support io_uring.\n");
+		MSG("Try `make USEURING=on` when building.\n");
+		info->io_uring_depth = 0;
+	}
+#endif
+
 	if (info->flag_exclude_xen_dom && !is_xen_memory()) {
 		MSG("'-X' option is disable,");
 		MSG("because %s is not Xen's memory core image.\n", info->name_memory);
@@ -4374,13 +5195,7 @@ initial(void)
 		if (has_vmcoreinfo() && !find_kaslr_offsets())
 			return FALSE;
 
-		if (!get_symbol_info())
-			return FALSE;
-
-		if (!get_structure_info())
-			return FALSE;
-
-		if (!get_srcfile_info())
+		if (!get_debuginfo_tables())
 			return FALSE;
 
 		debug_info = TRUE;
@@ -4527,6 +5342,8 @@ out:
 		DEBUG_MSG("Buffer size for the cyclic mode: %ld\n", info->bufsize_cyclic);
 	}
 
+	init_cycle_bitmap();
+
 	if (info->num_threads) {
 		if (is_xen_memory()) {
 			MSG("'--num-threads' option is disable,\n");
@@ -4620,6 +5437,24 @@ out:
         } else if (info->flag_usemmap == MMAP_DISABLE)
 		DEBUG_MSG("mmap() is disabled by specified option '--non-mmap'.\n");
 
+	/*
+	 * The translation doesn't change any more: phys_base, the KASLR
+	 * offset and the sadump backup region are settled.
+	 */
+	vtop_cache_flush();
+	info->flag_vtop_cache = TRUE;
+
+	/*
+	 * mem_map_batch must be a power of 2, so that no compound head
+	 * page is the last struct page of a batch.
+	 */
+	if (!info->mem_map_batch)
+		info->mem_map_batch = MEM_MAP_BATCH;
+	info->mem_map_batch = MAX(info->mem_map_batch, PGMM_CACHED);
+	while (info->mem_map_batch & (info->mem_map_batch - 1))
+		info->mem_map_batch &= info->mem_map_batch - 1;
+	DEBUG_MSG("mem_map batch: %lu struct pages\n", info->mem_map_batch);
+
 	return TRUE;
 }
 
@@ -4749,6 +5584,239 @@ set_bitmap(struct dump_bitmap *bitmap, mdf_pfn_t pfn, int val, struct cycle *cyc
 	}
 }
 
+/*
+ * The bitmaps are scanned a word at a time. Bit i of a bitmap buffer
+ * is the bit (i & 7) of the byte (i >> 3), so a word is loaded in
+ * little-endian order whatever the host is. The bytes beyond nbytes
+ * are not touched, and read as zero.
+ */
+#define BITMAP_WORD_BITS	(sizeof(uint64_t) * BITPERBYTE)
+
+static inline uint64_t
+load_bitmap_word(char *buf, mdf_pfn_t idx, size_t nbytes)
+{
+	size_t i, offset = idx * sizeof(uint64_t);
+	uint64_t word = 0;
+
+	if (offset + sizeof(word) <= nbytes) {
+		memcpy(&word, buf + offset, sizeof(word));
+#if __BYTE_ORDER == __BIG_ENDIAN
+		word = bswap_64(word);
+#endif
+		return word;
+	}
+	for (i = 0; offset + i < nbytes; i++)
+		word |= (uint64_t)(unsigned char)buf[offset + i] << (i * BITPERBYTE);
+
+	return word;
+}
+
+/*
+ * Return the first bit of the value val in [start, end) of buf,
+ * or end if there is none.
+ */
+static mdf_pfn_t
+find_bit_in_buffer(char *buf, mdf_pfn_t start, mdf_pfn_t end, int val)
+{
+	size_t nbytes = divideup(end, BITPERBYTE);
+	mdf_pfn_t i;
+	uint64_t word;
+
+	for (i = start; i < end; i = roundup(i + 1, BITMAP_WORD_BITS)) {
+		word = load_bitmap_word(buf, i / BITMAP_WORD_BITS, nbytes);
+		if (!val)
+			word = ~word;
+		word >>= i % BITMAP_WORD_BITS;
+		if (word)
+			return MIN(i + __builtin_ctzll(word), end);
+	}
+	return end;
+}
+
+/*
+ * Return the number of the set bits in [start, end) of buf.
+ */
+static mdf_pfn_t
+count_bits_in_buffer(char *buf, mdf_pfn_t start, mdf_pfn_t end)
+{
+	size_t nbytes = divideup(end, BITPERBYTE);
+	mdf_pfn_t i, count = 0;
+	uint64_t word;
+
+	for (i = start; i < end; i = roundup(i + 1, BITMAP_WORD_BITS)) {
+		word = load_bitmap_word(buf, i / BITMAP_WORD_BITS, nbytes);
+		word >>= i % BITMAP_WORD_BITS;
+		if (end - i < BITMAP_WORD_BITS)
+			word &= (1ULL << (end - i)) - 1;
+		count += __builtin_popcountll(word);
+	}
+	return count;
+}
+
+/*
+ * Set (val != 0) or clear the bits [start, end) of buf.
+ */
+static void
+set_bits_in_buffer(char *buf, mdf_pfn_t start, mdf_pfn_t end, int val)
+{
+	for (; start < end && start % BITPERBYTE; start++) {
+		if (val)
+			buf[start>>3] |= 1 << (start & 7);
+		else
+			buf[start>>3] &= ~(1 << (start & 7));
+	}
+	for (; start < end && end % BITPERBYTE; end--) {
+		if (val)
+			buf[(end - 1)>>3] |= 1 << ((end - 1) & 7);
+		else
+			buf[(end - 1)>>3] &= ~(1 << ((end - 1) & 7));
+	}
+	if (start < end)
+		memset(buf + (start>>3), val ? 0xff : 0,
+		       (end - start) / BITPERBYTE);
+}
+
+static mdf_pfn_t
+find_next_bit(struct dump_bitmap *bitmap, mdf_pfn_t pfn, mdf_pfn_t end_pfn,
+	      struct cycle *cycle, int val)
+{
+	mdf_pfn_t base, end, ret;
+
+	if (pfn >= end_pfn)
+		return end_pfn;
+
+	if (bitmap->fd < 0) {
+		/*
+		 * The pfns out of the cycle are not dumpable,
+		 * as is_dumpable() says.
+		 */
+		if (!is_cyclic_region(pfn, cycle)) {
+			if (!val)
+				return pfn;
+			if (!cycle || pfn >= cycle->end_pfn)
+				return end_pfn;
+			pfn = cycle->start_pfn;
+			if (pfn >= end_pfn)
+				return end_pfn;
+		}
+		end = MIN(end_pfn, cycle->end_pfn);
+		ret = cycle->start_pfn +
+			find_bit_in_buffer(bitmap->buf, pfn - cycle->start_pfn,
+					   end - cycle->start_pfn, val);
+		if (ret == end && val)
+			return end_pfn;
+		return ret;
+	}
+
+	while (pfn < end_pfn) {
+		/*
+		 * Load the block of pfn into bitmap->buf.
+		 */
+		is_dumpable_file(bitmap, pfn);
+
+		base = pfn - pfn % PFN_BUFBITMAP;
+		end = MIN(end_pfn, base + PFN_BUFBITMAP);
+		ret = base + find_bit_in_buffer(bitmap->buf, pfn - base,
+						end - base, val);
+		if (ret < end)
+			return ret;
+		pfn = end;
+	}
+	return end_pfn;
+}
+
+/*
+ * Return the first dumpable pfn in [pfn, end_pfn), or end_pfn
+ * if there is none.
+ */
+mdf_pfn_t
+find_next_set(struct dump_bitmap *bitmap, mdf_pfn_t pfn, mdf_pfn_t end_pfn,
+	      struct cycle *cycle)
+{
+	return find_next_bit(bitmap, pfn, end_pfn, cycle, 1);
+}
+
+/*
+ * Return the first excluded pfn in [pfn, end_pfn), or end_pfn
+ * if there is none.
+ */
+mdf_pfn_t
+find_next_zero(struct dump_bitmap *bitmap, mdf_pfn_t pfn, mdf_pfn_t end_pfn,
+	       struct cycle *cycle)
+{
+	return find_next_bit(bitmap, pfn, end_pfn, cycle, 0);
+}
+
+/*
+ * Return the number of the dumpable pfns in [pfn, end_pfn).
+ */
+mdf_pfn_t
+count_dumpable(struct dump_bitmap *bitmap, mdf_pfn_t pfn, mdf_pfn_t end_pfn,
+	       struct cycle *cycle)
+{
+	mdf_pfn_t base, end, count = 0;
+
+	if (bitmap->fd < 0) {
+		if (!cycle)
+			return 0;
+		pfn = MAX(pfn, cycle->start_pfn);
+		end_pfn = MIN(end_pfn, cycle->end_pfn);
+		if (pfn >= end_pfn)
+			return 0;
+		return count_bits_in_buffer(bitmap->buf,
+					    pfn - cycle->start_pfn,
+					    end_pfn - cycle->start_pfn);
+	}
+
+	for (; pfn < end_pfn; pfn = end) {
+		is_dumpable_file(bitmap, pfn);
+
+		base = pfn - pfn % PFN_BUFBITMAP;
+		end = MIN(end_pfn, base + PFN_BUFBITMAP);
+		count += count_bits_in_buffer(bitmap->buf, pfn - base,
+					      end - base);
+	}
+	return count;
+}
+
+/*
+ * Set (val != 0) or clear the bits of [pfn, end_pfn), and return the
+ * number of the pfns updated. The pfns out of the cycle are ignored
+ * for an on-memory bitmap.
+ */
+mdf_pfn_t
+set_bitmap_range(struct dump_bitmap *bitmap, mdf_pfn_t pfn, mdf_pfn_t end_pfn,
+		 int val, struct cycle *cycle)
+{
+	mdf_pfn_t base, end, count = 0;
+
+	if (bitmap->fd < 0) {
+		if (!cycle)
+			return 0;
+		pfn = MAX(pfn, cycle->start_pfn);
+		end_pfn = MIN(end_pfn, cycle->end_pfn);
+		if (pfn >= end_pfn)
+			return 0;
+		set_bits_in_buffer(bitmap->buf, pfn - cycle->start_pfn,
+				   end_pfn - cycle->start_pfn, val);
+		return end_pfn - pfn;
+	}
+
+	for (; pfn < end_pfn; pfn = end) {
+		/*
+		 * Write back the current block and load the block of pfn.
+		 */
+		if (!set_bitmap_file(bitmap, pfn, val))
+			break;
+
+		base = pfn - pfn % PFN_BUFBITMAP;
+		end = MIN(end_pfn, base + PFN_BUFBITMAP);
+		set_bits_in_buffer(bitmap->buf, pfn - base, end - base, val);
+		count += end - pfn;
+	}
+	return count;
+}
+
 int
 sync_bitmap(struct dump_bitmap *bitmap)
 {
@@ -4944,8 +6012,11 @@ write_and_check_space(int fd, void *buf, size_t buf_size, const char* desc,
 	return done == buf_size;
 }
 
-int
-write_buffer(int fd, off_t offset, void *buf, size_t buf_size, char *file_name)
+/*
+ * Prepare to write buf_size bytes at offset of the dump file.
+ */
+static int
+seek_dump_file(int fd, off_t offset, size_t buf_size, char *file_name)
 {
 	struct makedumpfile_data_header fdh;
 	const off_t failed = (off_t)-1;
@@ -4972,63 +6043,462 @@ write_buffer(int fd, off_t offset, void *buf, size_t buf_size, char *file_name)
 		return FALSE;
 	}
 
-	if (!write_and_check_space(fd, buf, buf_size, "dump", file_name))
-		return FALSE;
-
 	return TRUE;
 }
 
 int
-write_cache(struct cache_data *cd, void *buf, size_t size)
+write_buffer(int fd, off_t offset, void *buf, size_t buf_size, char *file_name)
 {
-	memcpy(cd->buf + cd->buf_size, buf, size);
-	cd->buf_size += size;
-
-	if (cd->buf_size < cd->cache_size)
-		return TRUE;
+	if (!seek_dump_file(fd, offset, buf_size, file_name))
+		return FALSE;
 
-	if (!write_buffer(cd->fd, cd->offset, cd->buf, cd->cache_size,
-	    cd->file_name))
+	if (!write_and_check_space(fd, buf, buf_size, "dump", file_name))
 		return FALSE;
 
-	cd->buf_size -= cd->cache_size;
-	memcpy(cd->buf, cd->buf + cd->cache_size, cd->buf_size);
-	cd->offset += cd->cache_size;
 	return TRUE;
 }
 
-int
-write_cache_bufsz(struct cache_data *cd)
+/*
+ * Write the buffers of iov, buf_size bytes in total, at offset with
+ * pwritev(). iov is consumed.
+ */
+static int
+write_buffer_iov(int fd, off_t offset, struct iovec *iov, int nr_iov,
+		 size_t buf_size, char *file_name)
 {
-	if (!cd->buf_size)
+	ssize_t retval;
+	int i;
+
+	/*
+	 * The flattened format, --dry-run and the size limit need
+	 * write_and_check_space().
+	 */
+	if (fd == STDOUT_FILENO || info->flag_dry_run
+	    || info->size_limit != -1) {
+		if (!seek_dump_file(fd, offset, buf_size, file_name))
+			return FALSE;
+		for (i = 0; i < nr_iov; i++) {
+			if (!write_and_check_space(fd, iov[i].iov_base,
+						   iov[i].iov_len, "dump",
+						   file_name))
+				return FALSE;
+		}
 		return TRUE;
+	}
 
-	if (!write_buffer(cd->fd, cd->offset, cd->buf, cd->buf_size,
-	    cd->file_name))
-		return FALSE;
+	while (nr_iov > 0) {
+		retval = pwritev(fd, iov, nr_iov, offset);
+		if (retval <= 0) {
+			if (retval == -1 && errno == EINTR)
+				continue;
+			if (retval == -1 && errno == ENOSPC)
+				info->flag_nospace = TRUE;
+			MSG("\nCan't write the dump file(%s). %s\n",
+			    file_name, strerror(retval ? errno : ENOSPC));
+			return FALSE;
+		}
+		write_bytes += retval;
+		offset += retval;
+
+		/*
+		 * Skip the written buffers.
+		 */
+		while (nr_iov > 0 && retval >= iov->iov_len) {
+			retval -= iov->iov_len;
+			iov++;
+			nr_iov--;
+		}
+		if (nr_iov > 0) {
+			iov->iov_base = (char *)iov->iov_base + retval;
+			iov->iov_len -= retval;
+		}
+	}
 
-	cd->offset  += cd->buf_size;
-	cd->buf_size = 0;
 	return TRUE;
 }
 
-int
-write_cache_zero(struct cache_data *cd, size_t size)
-{
-	if (!write_cache_bufsz(cd))
+/*
+ * Write buf_size bytes of buf at offset of the dump file of cd with
+ * --direct-io. The blocks of cd->align_direct bytes are written with
+ * O_DIRECT, which keeps them out of the page cache. The unaligned head
+ * is completed with the rest of its block read from the dump file,
+ * and the unaligned tail is written through the page cache, where it
+ * stays only until the next write completes its block.
+ */
+static int
+write_buffer_direct(struct cache_data *cd, off_t offset, char *buf,
+		    size_t buf_size)
+{
+	size_t align = cd->align_direct;
+	size_t head = offset % align, done = 0;
+	off_t start = offset - head;
+	off_t end = offset + buf_size;
+	off_t body_end = end - end % align;
+	ssize_t retval;
+
+	/*
+	 * The data within a block, or not placed at the same offset
+	 * from the alignment in memory, is written as usual.
+	 */
+	if (body_end <= start || buf - cd->buf_direct < head
+	    || (unsigned long)(buf - head) % align)
+		return write_buffer(cd->fd, offset, buf, buf_size,
+				    cd->file_name);
+
+	if (head) {
+		do {
+			retval = pread(cd->fd_direct, cd->block_direct,
+				       align, start);
+		} while (retval == -1 && errno == EINTR);
+		if (retval == -1)
+			goto fallback;
+		if (retval < head)
+			memset(cd->block_direct + retval, 0, head - retval);
+		memcpy(buf - head, cd->block_direct, head);
+	}
+
+	while (start + done < body_end) {
+		retval = pwrite(cd->fd_direct, buf - head + done,
+				body_end - start - done, start + done);
+		if (retval <= 0) {
+			if (retval == -1 && errno == EINTR)
+				continue;
+			if (retval == -1 && errno == EINVAL)
+				goto fallback;
+			if (retval == -1 && errno == ENOSPC)
+				info->flag_nospace = TRUE;
+			MSG("\nCan't write the dump file(%s). %s\n",
+			    cd->file_name, strerror(retval ? errno : ENOSPC));
+			return FALSE;
+		}
+		done += retval;
+
+		/*
+		 * The rest of a short write is not aligned any more.
+		 */
+		if (retval % align)
+			break;
+	}
+	if (done > head)
+		write_bytes += done - head;
+	else
+		done = head;
+
+	if (start + done < end
+	    && !write_buffer(cd->fd, start + done, buf - head + done,
+			     end - start - done, cd->file_name))
 		return FALSE;
 
-	memset(cd->buf + cd->buf_size, 0, size);
-	cd->buf_size += size;
+	return TRUE;
 
-	return write_cache_bufsz(cd);
+fallback:
+	MSG("\nCan't access the dump file(%s) with O_DIRECT, "
+	    "so '--direct-io' is ignored. %s\n", cd->file_name,
+	    strerror(errno));
+	cd->fd_direct = -1;
+
+	return write_buffer(cd->fd, offset, buf, buf_size, cd->file_name);
 }
 
-int
-read_buf_from_stdin(void *buf, int buf_size)
+/*
+ * With --direct-io, place the data of cd in cd->buf at the same
+ * offset from the alignment as in the dump file, so that its
+ * aligned part is also aligned in memory.
+ */
+static void
+align_cache_buf(struct cache_data *cd)
 {
-	int read_size = 0, tmp_read_size = 0;
-	time_t last_time, tm;
+	if (cd->buf_direct && !cd->buf_size)
+		cd->buf = cd->buf_direct + cd->offset % cd->align_direct;
+}
+
+#ifdef USEURING
+/*
+ * Wait for the write of req, and finish it with write() if it
+ * was short.
+ */
+static int
+complete_cache_uring_req(struct cache_data *cd, struct uring_req *req)
+{
+	struct cache_uring *cu = cd->uring;
+	int ret = TRUE;
+
+	if (!req->len)
+		return TRUE;
+
+	if (!wait_uring_req(&cu->io, req))
+		ret = FALSE;
+	else if (req->res < 0) {
+		if (req->res == -ENOSPC)
+			info->flag_nospace = TRUE;
+		MSG("\nCan't write the dump file(%s). %s\n",
+		    cd->file_name, strerror(-req->res));
+		ret = FALSE;
+	} else {
+		write_bytes += req->res;
+		if (req->res < req->len
+		    && !write_buffer(cd->fd, req->offset + req->res,
+				     req->buf + req->res, req->len - req->res,
+				     cd->file_name))
+			ret = FALSE;
+	}
+	req->len = 0;
+
+	return ret;
+}
+
+/*
+ * Wait for all the writes of cd.
+ */
+static int
+wait_cache_uring(struct cache_data *cd)
+{
+	int i, ret = TRUE;
+
+	if (!cd->uring)
+		return TRUE;
+
+	for (i = 0; i < cd->uring->nr_bufs; i++) {
+		if (!complete_cache_uring_req(cd, &cd->uring->req[i]))
+			ret = FALSE;
+	}
+
+	return ret;
+}
+
+/*
+ * Start writing the full buffer of cd, and continue filling the
+ * next one.
+ */
+static int
+flush_cache_uring(struct cache_data *cd)
+{
+	struct cache_uring *cu = cd->uring;
+	struct uring_req *req = &cu->req[cu->cur];
+	char *buf;
+
+	req->buf    = cd->buf;
+	req->len    = cd->cache_size;
+	req->offset = cd->offset;
+	if (!submit_uring_req(&cu->io, req, cd->fd, TRUE, cu->cur)) {
+		req->len = 0;
+		if (!write_buffer(cd->fd, cd->offset, cd->buf,
+				  cd->cache_size, cd->file_name))
+			return FALSE;
+		buf = cd->buf;
+	} else {
+		cu->cur = (cu->cur + 1) % cu->nr_bufs;
+		if (!complete_cache_uring_req(cd, &cu->req[cu->cur]))
+			return FALSE;
+		buf = cu->buf[cu->cur];
+	}
+	memcpy(buf, cd->buf + cd->cache_size, cd->buf_size - cd->cache_size);
+	cd->buf = buf;
+
+	return TRUE;
+}
+
+static int
+initialize_cache_uring(struct cache_data *cd)
+{
+	struct cache_uring *cu;
+	struct iovec *iov = NULL;
+	int i;
+
+	if ((cu = calloc(1, sizeof(struct cache_uring))) == NULL)
+		goto fail;
+
+	cu->nr_bufs = MAX(info->io_uring_depth, 2);
+	if ((cu->buf = calloc(cu->nr_bufs, sizeof(char *))) == NULL
+	    || (cu->req = calloc(cu->nr_bufs, sizeof(struct uring_req))) == NULL
+	    || (iov = calloc(cu->nr_bufs, sizeof(struct iovec))) == NULL)
+		goto fail;
+
+	cu->buf[0] = cd->buf;
+	for (i = 0; i < cu->nr_bufs; i++) {
+		if (i && (cu->buf[i] = malloc(cd->cache_size
+					      + info->page_size)) == NULL)
+			goto fail;
+		iov[i].iov_base = cu->buf[i];
+		iov[i].iov_len  = cd->cache_size + info->page_size;
+	}
+
+	if (!initialize_uring_io(&cu->io, iov, cu->nr_bufs))
+		goto fail;
+
+	free(iov);
+	cd->uring = cu;
+
+	return TRUE;
+fail:
+	if (cu) {
+		for (i = 1; cu->buf && i < cu->nr_bufs; i++)
+			free(cu->buf[i]);
+		free(cu->buf);
+		free(cu->req);
+		free(cu);
+	}
+	free(iov);
+
+	return FALSE;
+}
+
+static void
+free_cache_uring(struct cache_data *cd)
+{
+	struct cache_uring *cu = cd->uring;
+	int i;
+
+	if (!cu)
+		return;
+
+	wait_cache_uring(cd);
+	finalize_uring_io(&cu->io);
+
+	/*
+	 * cd->buf is freed by the caller.
+	 */
+	for (i = 0; i < cu->nr_bufs; i++) {
+		if (cu->buf[i] != cd->buf)
+			free(cu->buf[i]);
+	}
+	free(cu->buf);
+	free(cu->req);
+	free(cu);
+	cd->uring = NULL;
+}
+#endif /* USEURING */
+
+int
+write_cd_buf(struct cache_data *cd)
+{
+#ifdef USEURING
+	if (!wait_cache_uring(cd))
+		return FALSE;
+#endif
+	if (cd->buf_size == 0)
+		return TRUE;
+
+	if (cd->nr_iov)
+		return write_buffer_iov(cd->fd, cd->offset, cd->iov,
+					cd->nr_iov, cd->buf_size,
+					cd->file_name);
+
+	if (cd->fd_direct >= 0)
+		return write_buffer_direct(cd, cd->offset, cd->buf,
+					   cd->buf_size);
+
+	if (!write_buffer(cd->fd, cd->offset, cd->buf,
+			cd->buf_size, cd->file_name)) {
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+int
+write_cache_bufsz(struct cache_data *cd)
+{
+	if (!write_cd_buf(cd))
+		return FALSE;
+
+	cd->offset  += cd->buf_size;
+	cd->buf_size = 0;
+	cd->nr_iov   = 0;
+	return TRUE;
+}
+
+/*
+ * Add buf to cd without copying it. buf must not be changed until
+ * cd->nr_iov gets 0, which means that it has been written.
+ */
+int
+write_cache_iov(struct cache_data *cd, void *buf, size_t size)
+{
+	size_t len;
+
+	/*
+	 * With --direct-io, buf is copied into the aligned cd->buf.
+	 */
+	if (cd->buf_direct) {
+		while (size > 0) {
+			len = MIN(size, cd->cache_size - cd->buf_size);
+			if (!write_cache(cd, buf, len))
+				return FALSE;
+			buf = (char *)buf + len;
+			size -= len;
+		}
+		return TRUE;
+	}
+
+	if (!cd->nr_iov && cd->buf_size && !write_cache_bufsz(cd))
+		return FALSE;
+
+	cd->iov[cd->nr_iov].iov_base = buf;
+	cd->iov[cd->nr_iov].iov_len  = size;
+	cd->nr_iov++;
+	cd->buf_size += size;
+
+	if (cd->buf_size < cd->cache_size && cd->nr_iov < CACHE_IOV_NUM)
+		return TRUE;
+
+	return write_cache_bufsz(cd);
+}
+
+int
+write_cache(struct cache_data *cd, void *buf, size_t size)
+{
+	if (cd->nr_iov && !write_cache_bufsz(cd))
+		return FALSE;
+
+	align_cache_buf(cd);
+	memcpy(cd->buf + cd->buf_size, buf, size);
+	cd->buf_size += size;
+
+	if (cd->buf_size < cd->cache_size)
+		return TRUE;
+
+#ifdef USEURING
+	if (cd->uring) {
+		if (!flush_cache_uring(cd))
+			return FALSE;
+		cd->buf_size -= cd->cache_size;
+		cd->offset += cd->cache_size;
+		return TRUE;
+	}
+#endif
+	if (cd->fd_direct >= 0) {
+		if (!write_buffer_direct(cd, cd->offset, cd->buf,
+					 cd->cache_size))
+			return FALSE;
+	} else if (!write_buffer(cd->fd, cd->offset, cd->buf, cd->cache_size,
+	    cd->file_name))
+		return FALSE;
+
+	cd->buf_size -= cd->cache_size;
+	memcpy(cd->buf, cd->buf + cd->cache_size, cd->buf_size);
+	cd->offset += cd->cache_size;
+	return TRUE;
+}
+
+int
+write_cache_zero(struct cache_data *cd, size_t size)
+{
+	if (!write_cache_bufsz(cd))
+		return FALSE;
+
+	align_cache_buf(cd);
+	memset(cd->buf + cd->buf_size, 0, size);
+	cd->buf_size += size;
+
+	return write_cache_bufsz(cd);
+}
+
+int
+read_buf_from_stdin(void *buf, int buf_size)
+{
+	int read_size = 0, tmp_read_size = 0;
+	time_t last_time, tm;
 
 	last_time = time(NULL);
 
@@ -5967,23 +7437,7 @@ out:
 
 static mdf_pfn_t count_bits(char *buf, int sz)
 {
-	char *p = buf;
-	int i, j;
-	mdf_pfn_t cnt = 0;
-
-	for (i = 0; i < sz; i++, p++) {
-		if (*p == 0)
-			continue;
-		else if ((*p & 0xff) == 0xff) {
-			cnt += 8;
-			continue;
-		}
-		for (j = 0; j < 8; j++) {
-			if (*p & (1<<j))
-				cnt++;
-		}
-	}
-	return cnt;
+	return count_bits_in_buffer(buf, 0, (mdf_pfn_t)sz * BITPERBYTE);
 }
 
 /*
@@ -6305,6 +7759,13 @@ exclude_range(mdf_pfn_t *counter, mdf_pfn_t pfn, mdf_pfn_t endpfn,
 			endpfn = cycle->end_pfn;
 	}
 
+	if (!is_xen_memory()) {
+		if (pfn < endpfn)
+			*counter += set_bitmap_range(info->bitmap2, pfn, endpfn,
+						     0, cycle);
+		return;
+	}
+
 	while (pfn < endpfn) {
 		if (clear_bit_on_2nd_bitmap_for_kernel(pfn, cycle))
 			(*counter)++;
@@ -6312,9 +7773,37 @@ exclude_range(mdf_pfn_t *counter, mdf_pfn_t pfn, mdf_pfn_t endpfn,
 	}
 }
 
+/*
+ * The counters of the excluded pages. The main thread counts into the
+ * global counters; each thread scanning mem_map counts into its own,
+ * which are added to the global ones at the end.
+ */
+struct exclude_counter {
+	mdf_pfn_t	*cache;
+	mdf_pfn_t	*cache_private;
+	mdf_pfn_t	*user;
+	mdf_pfn_t	*free;
+	mdf_pfn_t	*hwpoison;
+	mdf_pfn_t	*offline;
+};
+
+static struct exclude_counter global_exclude_counter = {
+	.cache		= &pfn_cache,
+	.cache_private	= &pfn_cache_private,
+	.user		= &pfn_user,
+	.free		= &pfn_free,
+	.hwpoison	= &pfn_hwpoison,
+	.offline	= &pfn_offline,
+};
+
+/*
+ * Exclude the unnecessary pages of [pfn_start, pfn_end) by their struct
+ * pages at mem_map, which are read by reader.
+ */
 int
 __exclude_unnecessary_pages(unsigned long mem_map,
-    mdf_pfn_t pfn_start, mdf_pfn_t pfn_end, struct cycle *cycle)
+    mdf_pfn_t pfn_start, mdf_pfn_t pfn_end, struct cycle *cycle,
+    struct exclude_counter *ec, struct mem_map_reader *reader)
 {
 	mdf_pfn_t pfn;
 	mdf_pfn_t *pfn_counter;
@@ -6322,7 +7811,7 @@ __exclude_unnecessary_pages(unsigned long mem_map,
 	unsigned long index_pg, pfn_mm;
 	unsigned long long maddr;
 	mdf_pfn_t pfn_read_start, pfn_read_end;
-	unsigned char *page_cache;
+	unsigned char *page_cache = NULL;
 	unsigned char *pcache;
 	unsigned int _count, _mapcount = 0, compound_order = 0;
 	unsigned int order_offset, dtor_offset;
@@ -6347,12 +7836,6 @@ __exclude_unnecessary_pages(unsigned long mem_map,
 	pfn_read_start = ULONGLONG_MAX;
 	pfn_read_end   = 0;
 
-	page_cache = malloc(SIZE(page) * PGMM_CACHED);
-	if (!page_cache) {
-		ERRMSG("Can't allocate page cache: %s\n", strerror(errno));
-		return FALSE;
-	}
-
 	for (pfn = pfn_start; pfn < pfn_end; pfn++, mem_map += SIZE(page)) {
 
 		/*
@@ -6369,7 +7852,6 @@ __exclude_unnecessary_pages(unsigned long mem_map,
 			if (maddr == NOT_PADDR) {
 				ERRMSG("Can't convert a physical address(%llx) to machine address.\n",
 				    pfn_to_paddr(pfn));
-				free(page_cache);
 				return FALSE;
 			}
 			if (!is_in_segs(maddr))
@@ -6379,23 +7861,23 @@ __exclude_unnecessary_pages(unsigned long mem_map,
 				continue;
 		}
 
-		index_pg = pfn % PGMM_CACHED;
-		pcache  = page_cache + (index_pg * SIZE(page));
-
 		if (pfn < pfn_read_start || pfn_read_end < pfn) {
-			if (roundup(pfn + 1, PGMM_CACHED) < pfn_end)
-				pfn_mm = PGMM_CACHED - index_pg;
+			index_pg = pfn % info->mem_map_batch;
+			if (roundup(pfn + 1, info->mem_map_batch) < pfn_end)
+				pfn_mm = info->mem_map_batch - index_pg;
 			else
 				pfn_mm = pfn_end - pfn;
 
-			if (!readmem(VADDR, mem_map, pcache, SIZE(page) * pfn_mm)) {
+			page_cache = read_mem_map(reader, mem_map,
+						  SIZE(page) * pfn_mm);
+			if (!page_cache) {
 				ERRMSG("Can't read the buffer of struct page.\n");
-				free(page_cache);
 				return FALSE;
 			}
 			pfn_read_start = pfn;
 			pfn_read_end   = pfn + pfn_mm - 1;
 		}
+		pcache = page_cache + (pfn - pfn_read_start) * SIZE(page);
 
 		flags   = ULONG(pcache + OFFSET(page.flags));
 		_count  = UINT(pcache + OFFSET(page._refcount));
@@ -6424,9 +7906,9 @@ __exclude_unnecessary_pages(unsigned long mem_map,
 		/*
 		 * The last pfn of the mem_map cache must not be compound head
 		 * page since all compound pages are aligned to its page order
-		 * and PGMM_CACHED is a power of 2.
+		 * and mem_map_batch is a power of 2.
 		 */
-		if ((index_pg < PGMM_CACHED - 1) && isCompoundHead(flags)) {
+		if ((pfn < pfn_read_end) && isCompoundHead(flags)) {
 			unsigned char *addr = pcache + SIZE(page);
 
 			if (order_offset) {
@@ -6497,7 +7979,7 @@ __exclude_unnecessary_pages(unsigned long mem_map,
 				continue;
 			}
 			nr_pages = 1 << private;
-			pfn_counter = &pfn_free;
+			pfn_counter = ec->free;
 		}
 		/*
 		 * Exclude the non-private cache page.
@@ -6505,7 +7987,7 @@ __exclude_unnecessary_pages(unsigned long mem_map,
 		else if ((info->dump_level & DL_EXCLUDE_CACHE)
 		    && is_cache_page(flags)
 		    && !isPrivate(flags) && !isAnon(mapping)) {
-			pfn_counter = &pfn_cache;
+			pfn_counter = ec->cache;
 		}
 		/*
 		 * Exclude the cache page whether private or non-private.
@@ -6514,9 +7996,9 @@ __exclude_unnecessary_pages(unsigned long mem_map,
 		    && is_cache_page(flags)
 		    && !isAnon(mapping)) {
 			if (isPrivate(flags))
-				pfn_counter = &pfn_cache_private;
+				pfn_counter = ec->cache_private;
 			else
-				pfn_counter = &pfn_cache;
+				pfn_counter = ec->cache;
 		}
 		/*
 		 * Exclude the data page of the user process.
@@ -6525,19 +8007,19 @@ __exclude_unnecessary_pages(unsigned long mem_map,
 		 */
 		else if ((info->dump_level & DL_EXCLUDE_USER_DATA)
 			 && (isAnon(mapping) || isHugetlb(compound_dtor))) {
-			pfn_counter = &pfn_user;
+			pfn_counter = ec->user;
 		}
 		/*
 		 * Exclude the hwpoison page.
 		 */
 		else if (isHWPOISON(flags)) {
-			pfn_counter = &pfn_hwpoison;
+			pfn_counter = ec->hwpoison;
 		}
 		/*
 		 * Exclude pages that are logically offline.
 		 */
 		else if (isOffline(flags, _mapcount)) {
-			pfn_counter = &pfn_offline;
+			pfn_counter = ec->offline;
 		}
 		/*
 		 * Unexcludable page
@@ -6558,70 +8040,300 @@ __exclude_unnecessary_pages(unsigned long mem_map,
 		}
 	}
 
-	free(page_cache);
 	return TRUE;
 }
 
-int
-exclude_unnecessary_pages(struct cycle *cycle)
+/*
+ * The arguments of a thread scanning mem_map. The threads claim the
+ * mem_map_data entries one by one, and exclude the pages in their own
+ * copy of the cycle with their own counters.
+ */
+struct exclude_thread_args {
+	int			thread_num;
+	struct cycle		cycle;
+	struct exclude_counter	ec;
+	mdf_pfn_t		pfn_cache;
+	mdf_pfn_t		pfn_cache_private;
+	mdf_pfn_t		pfn_user;
+	mdf_pfn_t		pfn_free;
+	mdf_pfn_t		pfn_hwpoison;
+	mdf_pfn_t		pfn_offline;
+	mdf_pfn_t		pfn_done;	/* excluded by the previous cycle */
+	unsigned int		*next_mm;
+};
+
+static inline int
+is_mem_map_in_cycle(struct mem_map_data *mmd, struct cycle *cycle)
+{
+	if (mmd->mem_map == NOT_MEMMAP_ADDR)
+		return FALSE;
+
+	return mmd->pfn_end >= cycle->start_pfn &&
+		mmd->pfn_start <= cycle->end_pfn;
+}
+
+/*
+ * The threads can share the on-memory 2nd bitmap only if no byte of it
+ * is updated by two threads, i.e. every mem_map_data entry in the cycle
+ * starts at a byte boundary of the bitmap. The struct pages must be read
+ * from an ELF dump memory without Xen's translation.
+ */
+static int
+can_exclude_pages_parallel(struct cycle *cycle)
 {
 	unsigned int mm;
 	struct mem_map_data *mmd;
-	struct timespec ts_start;
 
-	if (is_xen_memory() && !info->dom0_mapnr) {
-		ERRMSG("Can't get max domain-0 PFN for excluding pages.\n");
+	if (info->num_threads < 2 || info->bitmap2->fd >= 0)
 		return FALSE;
-	}
 
-	clock_gettime(CLOCK_MONOTONIC, &ts_start);
+	if (info->flag_refiltering || info->flag_sadump || is_xen_memory())
+		return FALSE;
 
 	for (mm = 0; mm < info->num_mem_map; mm++) {
+		mmd = &info->mem_map_data[mm];
+		if (!is_mem_map_in_cycle(mmd, cycle))
+			continue;
+		if (mmd->pfn_start > cycle->start_pfn &&
+		    (mmd->pfn_start - cycle->start_pfn) % BITPERBYTE)
+			return FALSE;
+	}
+	return TRUE;
+}
 
-		if (!info->flag_mem_usage)
-			print_progress(PROGRESS_UNN_PAGES, mm, info->num_mem_map, NULL);
+static void *
+exclude_thread_function(void *arg)
+{
+	struct exclude_thread_args *ea = arg;
+	struct mem_map_data *mmd;
+	unsigned long mem_map;
+	mdf_pfn_t pfn_start;
+	unsigned int mm;
 
+	while ((mm = __atomic_fetch_add(ea->next_mm, 1, __ATOMIC_RELAXED))
+	       < info->num_mem_map) {
 		mmd = &info->mem_map_data[mm];
-
-		if (mmd->mem_map == NOT_MEMMAP_ADDR)
+		if (!is_mem_map_in_cycle(mmd, &ea->cycle))
 			continue;
 
-		if (mmd->pfn_end >= cycle->start_pfn &&
-		    mmd->pfn_start <= cycle->end_pfn) {
-			if (!__exclude_unnecessary_pages(mmd->mem_map,
-							 mmd->pfn_start, mmd->pfn_end, cycle))
-				return FALSE;
+		mem_map = mmd->mem_map;
+		pfn_start = mmd->pfn_start;
+		if (pfn_start < ea->pfn_done) {
+			if (mmd->pfn_end <= ea->pfn_done)
+				continue;
+			mem_map += (ea->pfn_done - pfn_start) * SIZE(page);
+			pfn_start = ea->pfn_done;
 		}
-	}
-	/*
-	 * print [100 %]
-	 */
-	if (!info->flag_mem_usage) {
-		print_progress(PROGRESS_UNN_PAGES, info->num_mem_map, info->num_mem_map, NULL);
-		print_execution_time(PROGRESS_UNN_PAGES, &ts_start);
+
+		if (!__exclude_unnecessary_pages(mem_map, pfn_start,
+						 mmd->pfn_end, &ea->cycle, &ea->ec,
+						 &MEM_MAP_READER_PARALLEL(ea->thread_num)))
+			pthread_exit(PTHREAD_FAIL);
 	}
 
-	return TRUE;
+	pthread_exit(NULL);
 }
 
-int
-copy_bitmap_buffer(void)
-{
-	memcpy(info->bitmap2->buf, info->bitmap1->buf,
-	       info->bufsize_cyclic);
-	return TRUE;
+/*
+ * Return the global counter of the thread's counter.
+ */
+static mdf_pfn_t *
+global_pfn_counter(struct exclude_thread_args *ea, mdf_pfn_t *counter)
+{
+	if (counter == &ea->pfn_cache)
+		return &pfn_cache;
+	if (counter == &ea->pfn_cache_private)
+		return &pfn_cache_private;
+	if (counter == &ea->pfn_user)
+		return &pfn_user;
+	if (counter == &ea->pfn_free)
+		return &pfn_free;
+	if (counter == &ea->pfn_hwpoison)
+		return &pfn_hwpoison;
+	return &pfn_offline;
 }
 
-int
-copy_bitmap_file(void)
+static int
+exclude_unnecessary_pages_parallel(struct cycle *cycle)
 {
-	off_t base, offset = 0;
- 	const off_t failed = (off_t)-1;
-	int fd;
-	struct disk_dump_header *dh = info->dh_memory;
-	unsigned char *buf;
-	int ret = FALSE;
-	long buf_size;
+	struct exclude_thread_args *args, *ea;
+	pthread_t **threads = info->threads;
+	mdf_pfn_t pfn_done = 0;
+	unsigned int next_mm = 0;
+	void *thread_result;
+	int i, res, nr_threads, ret = TRUE;
+
+	/*
+	 * If a multi-page exclusion is pending, do it first
+	 */
+	if (cycle->exclude_pfn_start < cycle->exclude_pfn_end) {
+		pfn_done = cycle->exclude_pfn_end;
+		exclude_range(cycle->exclude_pfn_counter,
+			cycle->exclude_pfn_start, cycle->exclude_pfn_end,
+			cycle);
+	}
+
+	args = calloc(info->num_threads, sizeof(*args));
+	if (!args) {
+		ERRMSG("Can't allocate memory for arguments of threads. %s\n",
+		       strerror(errno));
+		return FALSE;
+	}
+
+	res = pthread_mutex_init(&info->vtop_mutex, NULL);
+	if (res != 0) {
+		ERRMSG("Can't initialize vtop_mutex. %s\n", strerror(res));
+		free(args);
+		return FALSE;
+	}
+	res = pthread_rwlock_init(&info->usemmap_rwlock, NULL);
+	if (res != 0) {
+		ERRMSG("Can't initialize usemmap_rwlock. %s\n", strerror(res));
+		pthread_mutex_destroy(&info->vtop_mutex);
+		free(args);
+		return FALSE;
+	}
+
+	for (nr_threads = 0; nr_threads < info->num_threads; nr_threads++) {
+		ea = &args[nr_threads];
+		ea->thread_num = nr_threads;
+		ea->cycle.start_pfn = cycle->start_pfn;
+		ea->cycle.end_pfn = cycle->end_pfn;
+		ea->ec.cache = &ea->pfn_cache;
+		ea->ec.cache_private = &ea->pfn_cache_private;
+		ea->ec.user = &ea->pfn_user;
+		ea->ec.free = &ea->pfn_free;
+		ea->ec.hwpoison = &ea->pfn_hwpoison;
+		ea->ec.offline = &ea->pfn_offline;
+		ea->pfn_done = pfn_done;
+		ea->next_mm = &next_mm;
+
+		if (!init_mem_map_reader(&MEM_MAP_READER_PARALLEL(nr_threads),
+					 TRUE, FD_MEMORY_PARALLEL(nr_threads),
+					 &info->vtop_mutex)) {
+			ret = FALSE;
+			break;
+		}
+
+		res = pthread_create(threads[nr_threads], NULL,
+				     exclude_thread_function, ea);
+		if (res != 0) {
+			ERRMSG("Can't create thread %d. %s\n",
+			       nr_threads, strerror(res));
+			ret = FALSE;
+			break;
+		}
+	}
+
+	for (i = 0; i < nr_threads; i++) {
+		ea = &args[i];
+		res = pthread_join(*threads[i], &thread_result);
+		if (res != 0) {
+			ERRMSG("Can't join with thread %d. %s\n",
+			       i, strerror(res));
+			ret = FALSE;
+			continue;
+		}
+		if (thread_result == PTHREAD_FAIL)
+			ret = FALSE;
+
+		pfn_cache += ea->pfn_cache;
+		pfn_cache_private += ea->pfn_cache_private;
+		pfn_user += ea->pfn_user;
+		pfn_free += ea->pfn_free;
+		pfn_hwpoison += ea->pfn_hwpoison;
+		pfn_offline += ea->pfn_offline;
+
+		/*
+		 * Only the thread excluding the last pages of the cycle
+		 * can leave a multi-page exclusion for the next cycle.
+		 */
+		if (ea->cycle.exclude_pfn_start < ea->cycle.exclude_pfn_end) {
+			cycle->exclude_pfn_start = ea->cycle.exclude_pfn_start;
+			cycle->exclude_pfn_end = ea->cycle.exclude_pfn_end;
+			cycle->exclude_pfn_counter =
+				global_pfn_counter(ea, ea->cycle.exclude_pfn_counter);
+		}
+	}
+
+	pthread_rwlock_destroy(&info->usemmap_rwlock);
+	pthread_mutex_destroy(&info->vtop_mutex);
+	free(args);
+
+	return ret;
+}
+
+int
+exclude_unnecessary_pages(struct cycle *cycle)
+{
+	unsigned int mm;
+	struct mem_map_data *mmd;
+	struct timespec ts_start;
+
+	if (is_xen_memory() && !info->dom0_mapnr) {
+		ERRMSG("Can't get max domain-0 PFN for excluding pages.\n");
+		return FALSE;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts_start);
+
+	if (!init_mem_map_reader(&mm_reader, !info->flag_refiltering &&
+				 !info->flag_sadump && !is_xen_memory(),
+				 info->fd_memory, NULL))
+		return FALSE;
+
+	if (can_exclude_pages_parallel(cycle)) {
+		if (!info->flag_mem_usage)
+			print_progress(PROGRESS_UNN_PAGES, 0, info->num_mem_map, NULL);
+		if (!exclude_unnecessary_pages_parallel(cycle))
+			return FALSE;
+		goto out;
+	}
+
+	for (mm = 0; mm < info->num_mem_map; mm++) {
+
+		if (!info->flag_mem_usage)
+			print_progress(PROGRESS_UNN_PAGES, mm, info->num_mem_map, NULL);
+
+		mmd = &info->mem_map_data[mm];
+
+		if (is_mem_map_in_cycle(mmd, cycle)) {
+			if (!__exclude_unnecessary_pages(mmd->mem_map,
+							 mmd->pfn_start, mmd->pfn_end, cycle,
+							 &global_exclude_counter, &mm_reader))
+				return FALSE;
+		}
+	}
+out:
+	/*
+	 * print [100 %]
+	 */
+	if (!info->flag_mem_usage) {
+		print_progress(PROGRESS_UNN_PAGES, info->num_mem_map, info->num_mem_map, NULL);
+		print_execution_time(PROGRESS_UNN_PAGES, &ts_start);
+	}
+
+	return TRUE;
+}
+
+int
+copy_bitmap_buffer(void)
+{
+	memcpy(info->bitmap2->buf, info->bitmap1->buf,
+	       info->bufsize_cyclic);
+	return TRUE;
+}
+
+int
+copy_bitmap_file(void)
+{
+	off_t base, offset = 0;
+ 	const off_t failed = (off_t)-1;
+	int fd;
+	struct disk_dump_header *dh = info->dh_memory;
+	unsigned char *buf;
+	int ret = FALSE;
+	long buf_size;
 
 	buf_size = info->page_size;
 	buf = malloc(buf_size);
@@ -7000,8 +8712,176 @@ reset_save_control()
 	return TRUE;
 }
 
-int
-create_2nd_bitmap(struct cycle *cycle)
+void
+free_cycle_bitmap(void)
+{
+	unsigned long i;
+
+	if (info->cycle_bitmap == NULL)
+		return;
+
+	for (i = 0; i < info->num_cycle_bitmap; i++)
+		free(info->cycle_bitmap[i].buf);
+	free(info->cycle_bitmap);
+
+	info->cycle_bitmap = NULL;
+	info->num_cycle_bitmap = 0;
+	info->size_cycle_bitmap = 0;
+}
+
+/*
+ * Keep the 2nd-bitmap of each cycle compressed in memory, so that
+ * the passes over the cycles after the first one need not read mem_map
+ * again. This is done only if the copies fit in a part of free memory.
+ */
+void
+init_cycle_bitmap(void)
+{
+	unsigned long num;
+	unsigned long long limit;
+
+	/*
+	 * --exclude-unused-vm changes the 2nd-bitmap of the other cycles
+	 * while creating it.
+	 */
+	if (!info->flag_cyclic || info->flag_excludevm)
+		return;
+
+	limit = get_free_memory_size() * 0.2;
+	num = divideup(info->max_mapnr, info->pfn_cyclic);
+	if ((unsigned long long)num * sizeof(struct cycle_bitmap) >= limit)
+		goto out;
+
+	if ((info->cycle_bitmap = calloc(num, sizeof(struct cycle_bitmap))) == NULL)
+		goto out;
+
+	info->num_cycle_bitmap = num;
+	info->size_cycle_bitmap = num * sizeof(struct cycle_bitmap);
+	info->limit_cycle_bitmap = limit;
+
+	DEBUG_MSG("The 2nd-bitmap of each cycle is kept in memory (up to %lld byte).\n",
+		  limit);
+	return;
+out:
+	DEBUG_MSG("The 2nd-bitmap of each cycle is created in each pass.\n");
+}
+
+/*
+ * Return the slot of the cycle if it is one of the cycles of the first
+ * pass, which start at a multiple of pfn_cyclic.
+ */
+static struct cycle_bitmap *
+get_cycle_bitmap(struct cycle *cycle)
+{
+	unsigned long idx;
+	mdf_pfn_t end_pfn;
+
+	if (info->cycle_bitmap == NULL || cycle->start_pfn % info->pfn_cyclic)
+		return NULL;
+
+	idx = cycle->start_pfn / info->pfn_cyclic;
+	if (idx >= info->num_cycle_bitmap)
+		return NULL;
+
+	end_pfn = cycle->start_pfn + info->pfn_cyclic;
+	if (end_pfn > info->max_mapnr)
+		end_pfn = info->max_mapnr;
+	if (cycle->end_pfn != end_pfn)
+		return NULL;
+
+	return &info->cycle_bitmap[idx];
+}
+
+static void
+save_cycle_bitmap(struct cycle_bitmap *cb, struct cycle_bitmap *before,
+		  struct cycle *cycle)
+{
+	uLong len, size;
+	unsigned char *buf, *tmp;
+
+	len = divideup(cycle->end_pfn - cycle->start_pfn, BITPERBYTE);
+	size = compressBound(len);
+	if ((buf = malloc(size)) == NULL)
+		goto drop;
+
+	if (compress2(buf, &size, (Bytef *)info->bitmap2->buf, len,
+		      Z_BEST_SPEED) != Z_OK
+	    || info->size_cycle_bitmap + size > info->limit_cycle_bitmap) {
+		free(buf);
+		goto drop;
+	}
+	if ((tmp = realloc(buf, size)) != NULL)
+		buf = tmp;
+
+	cb->buf = buf;
+	cb->size = size;
+	cb->pfn_zero = pfn_zero - before->pfn_zero;
+	cb->pfn_cache = pfn_cache - before->pfn_cache;
+	cb->pfn_cache_private = pfn_cache_private - before->pfn_cache_private;
+	cb->pfn_user = pfn_user - before->pfn_user;
+	cb->pfn_free = pfn_free - before->pfn_free;
+	cb->pfn_hwpoison = pfn_hwpoison - before->pfn_hwpoison;
+	cb->pfn_offline = pfn_offline - before->pfn_offline;
+	cb->prev_exclude_pfn_start = before->prev_exclude_pfn_start;
+	cb->prev_exclude_pfn_end = before->prev_exclude_pfn_end;
+	cb->exclude_pfn_start = cycle->exclude_pfn_start;
+	cb->exclude_pfn_end = cycle->exclude_pfn_end;
+	cb->exclude_pfn_counter = cycle->exclude_pfn_counter;
+
+	info->size_cycle_bitmap += size;
+	return;
+drop:
+	DEBUG_MSG("Not enough memory to keep the 2nd-bitmap of each cycle.\n");
+	free_cycle_bitmap();
+}
+
+static int
+restore_cycle_bitmap(struct cycle_bitmap *cb, struct cycle *cycle)
+{
+	uLongf len;
+
+	len = divideup(cycle->end_pfn - cycle->start_pfn, BITPERBYTE);
+	if (uncompress((Bytef *)info->bitmap2->buf, &len, cb->buf,
+		       cb->size) != Z_OK) {
+		ERRMSG("Can't uncompress the 2nd-bitmap of the cycle.\n");
+		return FALSE;
+	}
+
+	pfn_zero += cb->pfn_zero;
+	pfn_cache += cb->pfn_cache;
+	pfn_cache_private += cb->pfn_cache_private;
+	pfn_user += cb->pfn_user;
+	pfn_free += cb->pfn_free;
+	pfn_hwpoison += cb->pfn_hwpoison;
+	pfn_offline += cb->pfn_offline;
+
+	cycle->exclude_pfn_start = cb->exclude_pfn_start;
+	cycle->exclude_pfn_end = cb->exclude_pfn_end;
+	cycle->exclude_pfn_counter = cb->exclude_pfn_counter;
+
+	return TRUE;
+}
+
+/*
+ * Check whether the cycle inherits the same multi-page region as
+ * it did at the first pass.
+ */
+static int
+is_same_pending_exclusion(struct cycle_bitmap *cb, struct cycle *cycle)
+{
+	int pending = cycle->exclude_pfn_start < cycle->exclude_pfn_end;
+	int saved = cb->prev_exclude_pfn_start < cb->prev_exclude_pfn_end;
+
+	if (!pending && !saved)
+		return TRUE;
+
+	return pending && saved
+		&& cycle->exclude_pfn_start == cb->prev_exclude_pfn_start
+		&& cycle->exclude_pfn_end == cb->prev_exclude_pfn_end;
+}
+
+static int
+__create_2nd_bitmap(struct cycle *cycle)
 {
 	/*
 	 * At first, clear all the bits on memory hole.
@@ -7102,6 +8982,39 @@ create_2nd_bitmap(struct cycle *cycle)
 	return TRUE;
 }
 
+int
+create_2nd_bitmap(struct cycle *cycle)
+{
+	struct cycle_bitmap *cb, before;
+
+	if ((cb = get_cycle_bitmap(cycle)) == NULL)
+		return __create_2nd_bitmap(cycle);
+
+	if (cb->buf) {
+		if (is_same_pending_exclusion(cb, cycle))
+			return restore_cycle_bitmap(cb, cycle);
+
+		return __create_2nd_bitmap(cycle);
+	}
+
+	before.pfn_zero = pfn_zero;
+	before.pfn_cache = pfn_cache;
+	before.pfn_cache_private = pfn_cache_private;
+	before.pfn_user = pfn_user;
+	before.pfn_free = pfn_free;
+	before.pfn_hwpoison = pfn_hwpoison;
+	before.pfn_offline = pfn_offline;
+	before.prev_exclude_pfn_start = cycle->exclude_pfn_start;
+	before.prev_exclude_pfn_end = cycle->exclude_pfn_end;
+
+	if (!__create_2nd_bitmap(cycle))
+		return FALSE;
+
+	save_cycle_bitmap(cb, &before, cycle);
+
+	return TRUE;
+}
+
 int
 prepare_bitmap1_buffer(void)
 {
@@ -7224,20 +9137,60 @@ prepare_cache_data(struct cache_data *cd)
 	cd->cache_size = info->page_size << info->block_order;
 	cd->buf_size   = 0;
 	cd->buf        = NULL;
-
-	if ((cd->buf = malloc(cd->cache_size + info->page_size)) == NULL) {
+	cd->nr_iov     = 0;
+	cd->fd_direct  = info->fd_dumpfile_direct;
+	cd->align_direct = info->align_dumpfile_direct;
+	cd->buf_direct = NULL;
+
+	/*
+	 * With --direct-io, cd->buf is moved by align_cache_buf() within
+	 * the first align_direct bytes of the aligned buffer, which is
+	 * followed by a block for write_buffer_direct().
+	 */
+	if (cd->fd_direct >= 0) {
+		if ((errno = posix_memalign((void **)&cd->buf_direct,
+					    cd->align_direct,
+					    cd->cache_size + info->page_size
+					    + cd->align_direct * 2))) {
+			ERRMSG("Can't allocate memory for the data buffer. %s\n",
+			    strerror(errno));
+			cd->buf_direct = NULL;
+			return FALSE;
+		}
+		cd->buf = cd->buf_direct;
+		cd->block_direct = cd->buf_direct + cd->align_direct
+				   + cd->cache_size + info->page_size;
+	} else if ((cd->buf = malloc(cd->cache_size + info->page_size)) == NULL) {
 		ERRMSG("Can't allocate memory for the data buffer. %s\n",
 		    strerror(errno));
 		return FALSE;
 	}
+	if ((cd->iov = malloc(sizeof(struct iovec) * CACHE_IOV_NUM)) == NULL) {
+		ERRMSG("Can't allocate memory for the iovec. %s\n",
+		    strerror(errno));
+		free(cd->buf_direct ? cd->buf_direct : cd->buf);
+		cd->buf = cd->buf_direct = NULL;
+		return FALSE;
+	}
+#ifdef USEURING
+	cd->uring = NULL;
+	if (info->io_uring_depth && cd->fd_direct < 0 && !info->flag_flatten
+	    && !info->flag_dry_run && info->size_limit == -1)
+		initialize_cache_uring(cd);
+#endif
 	return TRUE;
 }
 
 void
 free_cache_data(struct cache_data *cd)
 {
-	free(cd->buf);
-	cd->buf = NULL;
+#ifdef USEURING
+	free_cache_uring(cd);
+#endif
+	free(cd->buf_direct ? cd->buf_direct : cd->buf);
+	cd->buf = cd->buf_direct = NULL;
+	free(cd->iov);
+	cd->iov = NULL;
 }
 
 int
@@ -7519,6 +9472,19 @@ out:
 	return ret;
 }
 
+/*
+ * The sub header of header_version 6 ends before offset_zstd_dict.
+ * header_version 7 is used only for a dumpfile with a zstd dictionary.
+ */
+static size_t
+get_kdump_sub_header_size(struct kdump_sub_header *kh)
+{
+	if (kh->size_zstd_dict)
+		return sizeof(struct kdump_sub_header);
+
+	return offsetof(struct kdump_sub_header, offset_zstd_dict);
+}
+
 int
 write_kdump_header(void)
 {
@@ -7535,13 +9501,17 @@ write_kdump_header(void)
 
 	get_pt_note(&offset_note, &size_note);
 
+	memset(&kh, 0, sizeof(kh));
+	kh.size_zstd_dict = info->size_zstd_dict;
+	size = get_kdump_sub_header_size(&kh);
+
 	/*
 	 * Write common header
 	 */
 	memcpy(dh->signature, KDUMP_SIGNATURE, strlen(KDUMP_SIGNATURE));
-	dh->header_version = 6;
+	dh->header_version = kh.size_zstd_dict ? 7 : 6;
 	dh->block_size     = info->page_size;
-	dh->sub_hdr_size   = sizeof(kh) + size_note;
+	dh->sub_hdr_size   = size + size_note + kh.size_zstd_dict;
 	dh->sub_hdr_size   = divideup(dh->sub_hdr_size, dh->block_size);
 	/* dh->max_mapnr may be truncated, full 64bit in kh.max_mapnr_64 */
 	dh->max_mapnr      = MIN(info->max_mapnr, UINT_MAX);
@@ -7553,6 +9523,15 @@ write_kdump_header(void)
 	if (info->flag_excludevm)
 		dh->status |= DUMP_DH_EXCLUDED_VMEMMAP;
 
+	if (info->flag_same_filled)
+		dh->status |= DUMP_DH_FILLED_PAGES;
+
+	if (info->flag_dedup)
+		dh->status |= DUMP_DH_DEDUP_PAGES;
+
+	if (EXTENT_PAGES() > 1)
+		dh->status |= DUMP_DH_EXTENT;
+
 	if (info->flag_compress & DUMP_DH_COMPRESSED_ZLIB)
 		dh->status |= DUMP_DH_COMPRESSED_ZLIB;
 #ifdef USELZO
@@ -7567,6 +9546,10 @@ write_kdump_header(void)
 	else if (info->flag_compress & DUMP_DH_COMPRESSED_ZSTD)
 		dh->status |= DUMP_DH_COMPRESSED_ZSTD;
 #endif
+#ifdef USELZ4
+	else if (info->flag_compress & DUMP_DH_COMPRESSED_LZ4)
+		dh->status |= DUMP_DH_COMPRESSED_LZ4;
+#endif
 
 	size = sizeof(struct disk_dump_header);
 	if (!write_buffer(info->fd_dumpfile, 0, dh, size, info->name_dumpfile))
@@ -7575,8 +9558,7 @@ write_kdump_header(void)
 	/*
 	 * Write sub header
 	 */
-	size = sizeof(struct kdump_sub_header);
-	memset(&kh, 0, size);
+	size = get_kdump_sub_header_size(&kh);
 	/* 64bit max_mapnr_64 */
 	kh.max_mapnr_64 = info->max_mapnr;
 	kh.phys_base  = info->phys_base;
@@ -7599,7 +9581,7 @@ write_kdump_header(void)
 		 * Write ELF note section
 		 */
 		kh.offset_note
-			= DISKDUMP_HEADER_BLOCKS * dh->block_size + sizeof(kh);
+			= DISKDUMP_HEADER_BLOCKS * dh->block_size + size;
 		kh.size_note = size_note;
 
 		buf = malloc(size_note);
@@ -7643,6 +9625,16 @@ write_kdump_header(void)
 			kh.size_vmcoreinfo = size_vmcoreinfo;
 		}
 	}
+	if (kh.size_zstd_dict) {
+		/*
+		 * Write the zstd dictionary after ELF note section
+		 */
+		kh.offset_zstd_dict = DISKDUMP_HEADER_BLOCKS * dh->block_size
+			+ size + kh.size_note;
+		if (!write_buffer(info->fd_dumpfile, kh.offset_zstd_dict,
+		    info->zstd_dict, kh.size_zstd_dict, info->name_dumpfile))
+			goto out;
+	}
 	if (!write_buffer(info->fd_dumpfile, dh->block_size, &kh,
 	    size, info->name_dumpfile))
 		goto out;
@@ -7776,49 +9768,220 @@ prepare_splitblock_table(void)
 mdf_pfn_t
 get_num_dumpable(void)
 {
-	mdf_pfn_t pfn, num_dumpable;
-
 	initialize_2nd_bitmap(info->bitmap2);
 
-	for (pfn = 0, num_dumpable = 0; pfn < info->max_mapnr; pfn++) {
-		if (is_dumpable(info->bitmap2, pfn, NULL))
-			num_dumpable++;
-	}
-	return num_dumpable;
+	return count_dumpable(info->bitmap2, 0, info->max_mapnr, NULL);
 }
 
+void
+free_zstd_dict(void)
+{
+#ifdef USEZSTD
+	if (info->zstd_cdict)
+		ZSTD_freeCDict(info->zstd_cdict);
+	if (info->zstd_ddict)
+		ZSTD_freeDDict(info->zstd_ddict);
+	info->zstd_cdict = NULL;
+	info->zstd_ddict = NULL;
+#endif
+	free(info->zstd_dict);
+	free(info->zstd_samples);
+	info->zstd_dict = NULL;
+	info->size_zstd_dict = 0;
+	info->zstd_samples = NULL;
+	info->num_zstd_samples = 0;
+}
+
+#ifdef USEZSTD
 /*
- * generate splitblock_table
- * modified from function get_num_dumpable_cyclic
+ * Sample the dumpable pages of the cycle to train the dictionary of
+ * --zstd-dict. The first dumpable page of every (max_mapnr /
+ * ZSTD_DICT_SAMPLES) pfns is taken, unless it is filled with one value.
  */
-mdf_pfn_t
-get_num_dumpable_cyclic_withsplit(void)
+static int
+sample_zstd_dict_pages(struct cycle *cycle)
 {
-	mdf_pfn_t pfn, num_dumpable = 0;
-	mdf_pfn_t dumpable_pfn_num = 0, pfn_num = 0;
-	struct cycle cycle = {0};
-	int pos = 0;
+	mdf_pfn_t base, pfn, end, stride;
+	unsigned char *buf;
+	unsigned long long fill;
 
-	for_each_cycle(0, info->max_mapnr, &cycle) {
-		if (info->flag_cyclic) {
-			if (!create_2nd_bitmap(&cycle))
-				return FALSE;
-		}
+	if (info->zstd_samples == NULL)
+		return TRUE;
 
-		for (pfn = cycle.start_pfn; pfn < cycle.end_pfn; pfn++) {
-			if (is_dumpable(info->bitmap2, pfn, &cycle)) {
-				num_dumpable++;
-				dumpable_pfn_num++;
-			}
-			if (++pfn_num >= splitblock->page_per_splitblock) {
-				write_into_splitblock_table(splitblock->table + pos,
-							    dumpable_pfn_num);
-				pos += splitblock->entry_size;
-				pfn_num = 0;
-				dumpable_pfn_num = 0;
-			}
-		}
-	}
+	stride = MAX(info->max_mapnr / ZSTD_DICT_SAMPLES, 1);
+	for (base = roundup(cycle->start_pfn, stride);
+	     base < cycle->end_pfn
+	     && info->num_zstd_samples < ZSTD_DICT_SAMPLES;
+	     base += stride) {
+		end = MIN(base + stride, cycle->end_pfn);
+		pfn = find_next_set(info->bitmap2, base, end, cycle);
+		if (pfn >= end)
+			continue;
+
+		buf = info->zstd_samples
+			+ info->num_zstd_samples * info->page_size;
+		if (!read_pfn(pfn, buf))
+			return FALSE;
+		filter_data_buffer(buf, pfn_to_paddr(pfn), info->page_size);
+		if (!is_filled_page(buf, info->page_size, &fill))
+			info->num_zstd_samples++;
+	}
+
+	return TRUE;
+}
+
+static int
+prepare_zstd_dict(void)
+{
+	if (info->zstd_cdict)
+		ZSTD_freeCDict(info->zstd_cdict);
+	free(info->zstd_dict);
+	free(info->zstd_samples);
+	info->zstd_cdict = NULL;
+	info->zstd_dict = NULL;
+	info->size_zstd_dict = 0;
+	info->zstd_samples = NULL;
+	info->num_zstd_samples = 0;
+
+	if (!info->flag_zstd_dict)
+		return TRUE;
+
+	info->zstd_samples = malloc(ZSTD_DICT_SAMPLES * info->page_size);
+	if (info->zstd_samples == NULL) {
+		ERRMSG("Can't allocate memory for the zstd samples. %s\n",
+		       strerror(errno));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/*
+ * Train the dictionary from the sampled pages. If it fails, or if the
+ * dictionary does not make the sampled pages smaller, the pages are
+ * compressed without a dictionary.
+ */
+static int
+train_zstd_dict(void)
+{
+	size_t *sizes = NULL, size, size_trained, len_buf_out;
+	unsigned long long size_plain = 0, size_dict = 0;
+	unsigned char *sample, *buf_out = NULL;
+	ZSTD_CCtx *cctx = NULL;
+	unsigned long i;
+	int ret = FALSE;
+
+	if (info->zstd_samples == NULL)
+		return TRUE;
+
+	len_buf_out = ZSTD_compressBound(info->page_size);
+	if ((info->zstd_dict = malloc(ZSTD_DICT_SIZE)) == NULL
+	    || (sizes = malloc(sizeof(size_t) * ZSTD_DICT_SAMPLES)) == NULL
+	    || (buf_out = malloc(len_buf_out)) == NULL) {
+		ERRMSG("Can't allocate memory for the zstd dictionary. %s\n",
+		       strerror(errno));
+		goto out;
+	}
+	for (i = 0; i < info->num_zstd_samples; i++)
+		sizes[i] = info->page_size;
+
+	size_trained = ZDICT_trainFromBuffer(info->zstd_dict, ZSTD_DICT_SIZE,
+					     info->zstd_samples, sizes,
+					     info->num_zstd_samples);
+	if (ZDICT_isError(size_trained)) {
+		MSG("Can't train the zstd dictionary from %lu pages: %s\n",
+		    info->num_zstd_samples, ZDICT_getErrorName(size_trained));
+		goto no_dict;
+	}
+
+	info->zstd_cdict = ZSTD_createCDict(info->zstd_dict, size_trained, 1);
+	if ((cctx = ZSTD_createCCtx()) == NULL || info->zstd_cdict == NULL) {
+		ERRMSG("Can't create ZSTD_CDict.\n");
+		goto out;
+	}
+
+	for (i = 0; i < info->num_zstd_samples; i++) {
+		sample = info->zstd_samples + i * info->page_size;
+		size = ZSTD_compressCCtx(cctx, buf_out, len_buf_out, sample,
+					 info->page_size, 1);
+		size_plain += ZSTD_isError(size) ? info->page_size
+			: MIN(size, info->page_size);
+		size = ZSTD_compress_usingCDict(cctx, buf_out, len_buf_out,
+						sample, info->page_size,
+						info->zstd_cdict);
+		size_dict += ZSTD_isError(size) ? info->page_size
+			: MIN(size, info->page_size);
+	}
+	DEBUG_MSG("zstd dictionary  : %zu bytes from %lu pages\n",
+		  size_trained, info->num_zstd_samples);
+	DEBUG_MSG("  sampled pages  : %llu bytes, %llu bytes with it\n",
+		  size_plain, size_dict);
+	if (size_dict >= size_plain) {
+		MSG("The zstd dictionary does not make the sampled pages smaller.\n");
+		goto no_dict;
+	}
+	info->size_zstd_dict = size_trained;
+	ret = TRUE;
+	goto out;
+
+no_dict:
+	MSG("The pages are compressed without a dictionary.\n");
+	if (info->zstd_cdict)
+		ZSTD_freeCDict(info->zstd_cdict);
+	free(info->zstd_dict);
+	info->zstd_cdict = NULL;
+	info->zstd_dict = NULL;
+	ret = TRUE;
+out:
+	if (cctx != NULL)
+		ZSTD_freeCCtx(cctx);
+	free(buf_out);
+	free(sizes);
+	free(info->zstd_samples);
+	info->zstd_samples = NULL;
+
+	return ret;
+}
+
+#endif
+
+/*
+ * generate splitblock_table
+ * modified from function get_num_dumpable_cyclic
+ */
+mdf_pfn_t
+get_num_dumpable_cyclic_withsplit(void)
+{
+	mdf_pfn_t pfn, end, num, num_dumpable = 0;
+	mdf_pfn_t dumpable_pfn_num = 0, pfn_num = 0;
+	struct cycle cycle = {0};
+	int pos = 0;
+
+	for_each_cycle(0, info->max_mapnr, &cycle) {
+		if (info->flag_cyclic) {
+			if (!create_2nd_bitmap(&cycle))
+				return FALSE;
+		}
+#ifdef USEZSTD
+		if (!sample_zstd_dict_pages(&cycle))
+			return FALSE;
+#endif
+
+		for (pfn = cycle.start_pfn; pfn < cycle.end_pfn; pfn = end) {
+			end = MIN(cycle.end_pfn, pfn + splitblock->page_per_splitblock - pfn_num);
+			num = count_dumpable(info->bitmap2, pfn, end, &cycle);
+			num_dumpable += num;
+			dumpable_pfn_num += num;
+			pfn_num += end - pfn;
+			if (pfn_num >= splitblock->page_per_splitblock) {
+				write_into_splitblock_table(splitblock->table + pos,
+							    dumpable_pfn_num);
+				pos += splitblock->entry_size;
+				pfn_num = 0;
+				dumpable_pfn_num = 0;
+			}
+		}
+	}
 
 	return num_dumpable;
 }
@@ -7826,7 +9989,7 @@ get_num_dumpable_cyclic_withsplit(void)
 mdf_pfn_t
 get_num_dumpable_cyclic_single(void)
 {
-	mdf_pfn_t pfn, num_dumpable=0;
+	mdf_pfn_t num_dumpable=0;
 	struct cycle cycle = {0};
 
 	for_each_cycle(0, info->max_mapnr, &cycle)
@@ -7835,10 +9998,13 @@ get_num_dumpable_cyclic_single(void)
 			if (!create_2nd_bitmap(&cycle))
 				return FALSE;
 		}
+#ifdef USEZSTD
+		if (!sample_zstd_dict_pages(&cycle))
+			return FALSE;
+#endif
 
-		for(pfn=cycle.start_pfn; pfn<cycle.end_pfn; pfn++)
-			if (is_dumpable(info->bitmap2, pfn, &cycle))
-				num_dumpable++;
+		num_dumpable += count_dumpable(info->bitmap2, cycle.start_pfn,
+					       cycle.end_pfn, &cycle);
 	}
 
 	return num_dumpable;
@@ -7862,6 +10028,10 @@ create_dump_bitmap(void)
 		if (!prepare_splitblock_table())
 			goto out;
 	}
+#ifdef USEZSTD
+	if (!prepare_zstd_dict())
+		goto out;
+#endif
 
 	if (info->flag_cyclic) {
 		if (!prepare_bitmap2_buffer())
@@ -7889,6 +10059,10 @@ create_dump_bitmap(void)
 		if (!(info->num_dumpable = get_num_dumpable_cyclic()))
 			goto out;
 	}
+#ifdef USEZSTD
+	if (!train_zstd_dict())
+		goto out;
+#endif
 
 	ret = TRUE;
 out:
@@ -7967,6 +10141,7 @@ read_pfn(mdf_pfn_t pfn, unsigned char *buf)
 int
 read_pfn_parallel(int fd_memory, mdf_pfn_t pfn, unsigned char *buf,
 		  struct dump_bitmap* bitmap_memory_parallel,
+		  struct page_desc_cache *pd_cache,
 		  struct mmap_cache *mmap_cache)
 {
 	unsigned long long paddr;
@@ -7978,13 +10153,14 @@ read_pfn_parallel(int fd_memory, mdf_pfn_t pfn, unsigned char *buf,
 
 	if (info->flag_refiltering) {
 		if (!readpage_kdump_compressed_parallel(fd_memory, pgaddr, buf,
-						      bitmap_memory_parallel)) {
+						      bitmap_memory_parallel,
+						      pd_cache)) {
 			ERRMSG("Can't get the page data.\n");
 			return FALSE;
 		}
 	} else {
 		char *mapbuf = mappage_elf_parallel(fd_memory, pgaddr,
-						    mmap_cache);
+						    info->page_size, mmap_cache);
 		if (mapbuf) {
 			memcpy(buf, mapbuf, info->page_size);
 		} else {
@@ -7998,12 +10174,87 @@ read_pfn_parallel(int fd_memory, mdf_pfn_t pfn, unsigned char *buf,
 	return TRUE;
 }
 
+/*
+ * Get the offset of the pfns [pfn, pfn + nr) in the dump memory if they
+ * are contiguous in a PT_LOAD segment, and 0 otherwise.
+ */
+static off_t
+pfn_range_to_offset(mdf_pfn_t pfn, mdf_pfn_t nr)
+{
+	unsigned long long paddr = pfn_to_paddr(pfn);
+	unsigned long size = nr * info->page_size;
+	off_t offset, offset2;
+
+	if (info->flag_refiltering)
+		return 0;
+
+	offset = paddr_to_offset(paddr);
+	if (!offset || page_is_fractional(offset))
+		return 0;
+
+	offset2 = paddr_to_offset(paddr + size - 1);
+	if (offset2 - offset != size - 1
+	    || offset_to_pt_load_end(offset) - offset < size)
+		return 0;
+
+	return offset;
+}
+
+/*
+ * Read the run of contiguous pfns [pfn, pfn + nr) into buf. The run is
+ * copied at once if it is contiguous in a PT_LOAD segment of the dump
+ * memory, and read page by page otherwise.
+ */
+static int
+read_pfn_range_parallel(int fd_memory, mdf_pfn_t pfn, mdf_pfn_t nr,
+			unsigned char *buf,
+			struct dump_bitmap *bitmap_memory_parallel,
+			struct page_desc_cache *pd_cache,
+			struct mmap_cache *mmap_cache)
+{
+	unsigned long size = nr * info->page_size;
+	off_t offset;
+	char *mapbuf;
+	mdf_pfn_t i;
+
+	if (info->flag_refiltering)
+		return read_pfn_range_kdump_compressed(fd_memory, pd_cache,
+						       bitmap_memory_parallel,
+						       pfn, nr, buf);
+
+	if (nr == 1)
+		goto per_page;
+
+	mapbuf = mappage_elf_parallel(fd_memory, pfn_to_paddr(pfn), size,
+				      mmap_cache);
+	if (mapbuf) {
+		memcpy(buf, mapbuf, size);
+		return TRUE;
+	}
+
+	if ((offset = pfn_range_to_offset(pfn, nr)) == 0)
+		goto per_page;
+
+	return read_from_vmcore_parallel(fd_memory, offset, buf, size);
+
+per_page:
+	for (i = 0; i < nr; i++) {
+		if (!read_pfn_parallel(fd_memory, pfn + i,
+				       buf + i * info->page_size,
+				       bitmap_memory_parallel, pd_cache,
+				       mmap_cache))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
 int
 get_loads_dumpfile_cyclic(void)
 {
 	int i, phnum, num_new_load = 0;
 	long page_size = info->page_size;
-	mdf_pfn_t pfn, pfn_start, pfn_end, num_excluded;
+	mdf_pfn_t pfn, pfn_start, pfn_end, num_excluded, end;
 	unsigned long frac_head, frac_tail;
 	Elf64_Phdr load;
 	struct cycle cycle = {0};
@@ -8036,10 +10287,14 @@ get_loads_dumpfile_cyclic(void)
 					return FALSE;
 			}
 			for (pfn = MAX(pfn_start, cycle.start_pfn); pfn < cycle.end_pfn; pfn++) {
-				if (!is_dumpable(info->bitmap2, pfn, &cycle)) {
-					num_excluded++;
-					continue;
-				}
+				/*
+				 * Skip a run of the excluded pages.
+				 */
+				end = find_next_set(info->bitmap2, pfn, cycle.end_pfn, &cycle);
+				num_excluded += end - pfn;
+				pfn = end;
+				if (pfn >= cycle.end_pfn)
+					break;
 
 				/*
 				 * If the number of the contiguous pages to be excluded
@@ -8063,6 +10318,7 @@ write_elf_pages_cyclic(struct cache_data *cd_header, struct cache_data *cd_page)
 	int i, phnum;
 	long page_size = info->page_size;
 	mdf_pfn_t pfn, pfn_start, pfn_end, num_excluded, num_dumpable, per;
+	mdf_pfn_t end;
 	unsigned long long paddr;
 	unsigned long long memsz, filesz;
 	unsigned long frac_head, frac_tail;
@@ -8131,18 +10387,27 @@ write_elf_pages_cyclic(struct cache_data *cd_header, struct cache_data *cd_page)
 			}
 
 			for (pfn = MAX(pfn_start, cycle.start_pfn); pfn < cycle.end_pfn; pfn++) {
-				if (info->flag_cyclic)
-					pfn_memhole--;
-
-				if (!is_dumpable(info->bitmap2, pfn, &cycle)) {
-					num_excluded++;
-					if ((pfn == pfn_end - 1) && frac_tail)
+				/*
+				 * Skip a run of the excluded pages.
+				 */
+				end = find_next_set(info->bitmap2, pfn, cycle.end_pfn, &cycle);
+				if (end > pfn) {
+					if (info->flag_cyclic)
+						pfn_memhole -= end - pfn;
+					num_excluded += end - pfn;
+					memsz += page_size * (end - pfn - 1);
+					if ((end == pfn_end) && frac_tail)
 						memsz += frac_tail;
 					else
 						memsz += page_size;
-					continue;
+					pfn = end;
+					if (pfn >= cycle.end_pfn)
+						break;
 				}
 
+				if (info->flag_cyclic)
+					pfn_memhole--;
+
 				if ((num_dumped % per) == 0)
 					print_progress(PROGRESS_COPY, num_dumped, num_dumpable, &ts_start);
 
@@ -8276,19 +10541,6 @@ write_elf_pages_cyclic(struct cache_data *cd_header, struct cache_data *cd_page)
 	return TRUE;
 }
 
-int
-write_cd_buf(struct cache_data *cd)
-{
-	if (cd->buf_size == 0)
-		return TRUE;
-
-	if (!write_buffer(cd->fd, cd->offset, cd->buf,
-			cd->buf_size, cd->file_name)) {
-		return FALSE;
-	}
-
-	return TRUE;
-}
 
 /*
  * get_nr_pages is used for generating incomplete kdump core.
@@ -8333,7 +10585,8 @@ write_kdump_page(struct cache_data *cd_header, struct cache_data *cd_page,
 	 * With that, when enospc occurs, we can save more useful information.
 	 */
 	if (cd_header->buf_size + sizeof(*pd) >= cd_header->cache_size ||
-	    cd_page->buf_size + pd->size >= cd_page->cache_size) {
+	    cd_page->buf_size + pd->size >= cd_page->cache_size ||
+	    cd_page->nr_iov + 1 >= CACHE_IOV_NUM) {
 		if( !write_cd_buf(cd_header) ) {
 			memset(cd_header->buf, 0, cd_header->cache_size);
 			write_cd_buf(cd_header);
@@ -8358,10 +10611,11 @@ write_kdump_page(struct cache_data *cd_header, struct cache_data *cd_page,
 		cd_page->offset += cd_page->buf_size;
 		cd_header->buf_size = 0;
 		cd_page->buf_size = 0;
+		cd_page->nr_iov = 0;
 	}
 
 	write_cache(cd_header, pd, sizeof(page_desc_t));
-	write_cache(cd_page, page_data, pd->size);
+	write_cache_iov(cd_page, page_data, pd->size);
 
 	return TRUE;
 }
@@ -8405,6 +10659,26 @@ int compress_mdf (z_stream *stream, Bytef *dest, uLongf *destLen,
 	return err;
 }
 
+#ifdef USEZSTD
+/*
+ * Compress with the dictionary of --zstd-dict if it has been trained.
+ * The level of the dictionary is fixed, so it is not used with
+ * --compress-budget.
+ */
+static size_t
+compress_zstd(ZSTD_CCtx *cctx, void *dst, size_t dst_size,
+	      const void *src, size_t src_size, struct compress_adapt *ca)
+{
+	if (info->zstd_cdict)
+		return ZSTD_compress_usingCDict(cctx, dst, dst_size, src,
+						src_size, info->zstd_cdict);
+
+	return ZSTD_compressCCtx(cctx, dst, dst_size, src, src_size,
+				 ca->strong ? ZSTD_LEVEL_STRONG
+					    : COMPRESS_LEVEL_FAST);
+}
+#endif
+
 int finalize_zlib(z_stream *stream)
 {
 	int err;
@@ -8413,196 +10687,755 @@ int finalize_zlib(z_stream *stream)
 	return err;
 }
 
+/*
+ * Hash the page with two independent 64-bit hashes, so that pages are
+ * taken as identical only if both of them match.
+ */
 static void
-cleanup_mutex(void *mutex) {
-	pthread_mutex_unlock(mutex);
+hash_page(unsigned char *buf, long page_size, unsigned long long *hash,
+	  unsigned long long *check)
+{
+	unsigned long long h1 = 0x27d4eb2f165667c5ULL;
+	unsigned long long h2 = 0xcbf29ce484222325ULL;
+	unsigned long long w;
+	long i;
+
+	for (i = 0; i < page_size; i += sizeof(w)) {
+		memcpy(&w, buf + i, sizeof(w));
+		h1 += w * 0xc2b2ae3d27d4eb4fULL;
+		h1 = ((h1 << 31) | (h1 >> 33)) * 0x9e3779b185ebca87ULL;
+		h2 = (h2 ^ w) * 0x100000001b3ULL;
+		h2 ^= h2 >> 29;
+	}
+	h1 ^= h1 >> 33;
+	h1 *= 0xff51afd7ed558ccdULL;
+	h1 ^= h1 >> 33;
+	h2 ^= h2 >> 32;
+	h2 *= 0xc4ceb9fe1a85ec53ULL;
+	h2 ^= h2 >> 29;
+
+	*hash = h1 ? h1 : 1;
+	*check = h2;
+}
+
+static struct dedup_entry *
+lookup_dedup_entry(struct dedup_entry *table, unsigned long long hash,
+		   unsigned long long check)
+{
+	struct dedup_entry *entry;
+	unsigned long long h;
+	int i;
+
+	entry = &table[(hash % DEDUP_TABLE_NUM) & ~(DEDUP_WAYS - 1)];
+	for (i = 0; i < DEDUP_WAYS; i++, entry++) {
+		h = __atomic_load_n(&entry->hash, __ATOMIC_ACQUIRE);
+		if (!h)
+			break;
+		if (h == hash && entry->check == check)
+			return entry;
+	}
+	return NULL;
 }
 
-void *
-kdump_thread_function_cyclic(void *arg) {
-	void *retval = PTHREAD_FAIL;
-	struct thread_args *kdump_thread_args = (struct thread_args *)arg;
-	volatile struct page_data *page_data_buf = kdump_thread_args->page_data_buf;
-	volatile struct page_flag *page_flag_buf = kdump_thread_args->page_flag_buf;
-	struct cycle *cycle = kdump_thread_args->cycle;
-	mdf_pfn_t pfn = cycle->start_pfn;
-	int index = kdump_thread_args->thread_num;
-	int buf_ready;
-	int dumpable;
-	int fd_memory = 0;
-	struct dump_bitmap bitmap_parallel = {0};
-	struct dump_bitmap bitmap_memory_parallel = {0};
-	unsigned char *buf = NULL, *buf_out = NULL;
-	struct mmap_cache *mmap_cache =
-			MMAP_CACHE_PARALLEL(kdump_thread_args->thread_num);
-	unsigned long size_out;
-	z_stream *stream = &ZLIB_STREAM_PARALLEL(kdump_thread_args->thread_num);
-#ifdef USELZO
-	lzo_bytep wrkmem = WRKMEM_PARALLEL(kdump_thread_args->thread_num);
-#endif
-#ifdef USEZSTD
-	ZSTD_CCtx *cctx = ZSTD_CCTX_PARALLEL(kdump_thread_args->thread_num);
-#endif
+/*
+ * Add the page written with pd. Only the page writer of the table adds
+ * entries, and the hash is stored last to publish the entry to the
+ * producers.
+ */
+static void
+add_dedup_entry(struct dedup_entry *table, unsigned long long hash,
+		unsigned long long check, mdf_pfn_t pfn, struct page_desc *pd)
+{
+	struct dedup_entry *entry;
+	int i;
 
-	buf = BUF_PARALLEL(kdump_thread_args->thread_num);
-	buf_out = BUF_OUT_PARALLEL(kdump_thread_args->thread_num);
+	entry = &table[(hash % DEDUP_TABLE_NUM) & ~(DEDUP_WAYS - 1)];
+	for (i = 0; i < DEDUP_WAYS; i++, entry++) {
+		if (entry->hash)
+			continue;
+		entry->check  = check;
+		entry->pfn    = pfn;
+		entry->offset = pd->offset;
+		entry->size   = pd->size;
+		entry->flags  = pd->flags;
+		__atomic_store_n(&entry->hash, hash, __ATOMIC_RELEASE);
+		return;
+	}
+}
 
-	fd_memory = FD_MEMORY_PARALLEL(kdump_thread_args->thread_num);
+static void
+set_dedup_page_desc(struct page_desc *pd, struct dedup_entry *entry)
+{
+	pd->offset     = entry->offset;
+	pd->size       = entry->size;
+	pd->flags      = entry->flags;
+	pd->page_flags = 0;
+}
 
-	if (info->fd_bitmap >= 0) {
-		bitmap_parallel.buf = malloc(BUFSIZE_BITMAP);
-		if (bitmap_parallel.buf == NULL){
-			ERRMSG("Can't allocate memory for bitmap_parallel.buf. %s\n",
-			strerror(errno));
-			goto fail;
-		}
-		initialize_2nd_bitmap_parallel(&bitmap_parallel,
-					kdump_thread_args->thread_num);
-	}
+/*
+ * Start a new dumpfile with an empty table.
+ */
+static int
+prepare_dedup_table(struct dedup_entry **table)
+{
+	if (!info->flag_dedup)
+		return TRUE;
 
-	if (info->flag_refiltering) {
-		bitmap_memory_parallel.buf = malloc(BUFSIZE_BITMAP);
-		if (bitmap_memory_parallel.buf == NULL){
-			ERRMSG("Can't allocate memory for bitmap_memory_parallel.buf. %s\n",
-			strerror(errno));
-			goto fail;
+	if (*table == NULL) {
+		*table = calloc(DEDUP_TABLE_NUM, sizeof(struct dedup_entry));
+		if (*table == NULL) {
+			ERRMSG("Can't allocate memory for the dedup table. %s\n",
+			       strerror(errno));
+			return FALSE;
 		}
-		initialize_bitmap_memory_parallel(&bitmap_memory_parallel,
-						kdump_thread_args->thread_num);
-	}
+	} else
+		memset(*table, 0, DEDUP_TABLE_NUM * sizeof(struct dedup_entry));
 
-	/*
-	 * filtered page won't take anything
-	 * unfiltered zero page will only take a page_flag_buf
-	 * unfiltered non-zero page will take a page_flag_buf and a page_data_buf
-	 */
-	while (pfn < cycle->end_pfn) {
-		buf_ready = FALSE;
+	return TRUE;
+}
 
-		pthread_mutex_lock(&info->page_data_mutex);
-		pthread_cleanup_push(cleanup_mutex, &info->page_data_mutex);
-		while (page_data_buf[index].used != FALSE) {
-			pthread_testcancel();
-			index = (index + 1) % info->num_buffers;
-		}
-		page_data_buf[index].used = TRUE;
-		pthread_cleanup_pop(1);
+static void
+cleanup_mutex(void *mutex) {
+	pthread_mutex_unlock(mutex);
+}
 
-		while (buf_ready == FALSE) {
-			pthread_testcancel();
-			if (page_flag_buf->ready == FLAG_READY)
-				continue;
+/*
+ * Check that the page of pfn, filtered as it was written, is identical
+ * to page. buf is a page-sized buffer to read it into.
+ */
+static int
+is_same_page(mdf_pfn_t pfn, unsigned char *page, unsigned char *buf)
+{
+	if (!read_pfn(pfn, buf))
+		return FALSE;
+	filter_data_buffer(buf, pfn_to_paddr(pfn), info->page_size);
 
-			/* get next dumpable pfn */
-			pthread_mutex_lock(&info->current_pfn_mutex);
-			for (pfn = info->current_pfn; pfn < cycle->end_pfn; pfn++) {
-				dumpable = is_dumpable(
-					info->fd_bitmap >= 0 ? &bitmap_parallel : info->bitmap2,
-					pfn,
-					cycle);
-				if (dumpable)
-					break;
-			}
-			info->current_pfn = pfn + 1;
+	return memcmp(page, buf, info->page_size) == 0;
+}
 
-			page_flag_buf->pfn = pfn;
-			page_flag_buf->ready = FLAG_FILLING;
-			pthread_mutex_unlock(&info->current_pfn_mutex);
-			sem_post(&info->page_flag_buf_sem);
+/*
+ * Same as is_same_page(), with the dump memory of the thread.
+ */
+static int
+is_same_page_parallel(int thread_num, mdf_pfn_t pfn, unsigned char *page,
+		      unsigned char *buf,
+		      struct dump_bitmap *bitmap_memory_parallel,
+		      struct mmap_cache *mmap_cache)
+{
+	if (!read_pfn_parallel(FD_MEMORY_PARALLEL(thread_num), pfn, buf,
+			       bitmap_memory_parallel,
+			       &PAGE_DESC_CACHE_PARALLEL(thread_num),
+			       mmap_cache))
+		return FALSE;
+	filter_data_buffer(buf, pfn_to_paddr(pfn), info->page_size);
 
-			if (pfn >= cycle->end_pfn) {
-				info->current_pfn = cycle->end_pfn;
-				page_data_buf[index].used = FALSE;
-				break;
-			}
+	return memcmp(page, buf, info->page_size) == 0;
+}
 
-			if (!read_pfn_parallel(fd_memory, pfn, buf,
-					       &bitmap_memory_parallel,
-					       mmap_cache))
-					goto fail;
+/*
+ * Check that the pages of pfn1 and pfn2 are identical, with the reader
+ * of the page writer. buf is a buffer of two pages.
+ */
+static int
+is_same_pfn(struct page_writer *pw, mdf_pfn_t pfn1, mdf_pfn_t pfn2,
+	    unsigned char *buf, struct dump_bitmap *bitmap_memory)
+{
+	if (!read_pfn_parallel(pw->fd_memory, pfn1, buf, bitmap_memory,
+			       &pw->page_desc_cache, &pw->mmap_cache))
+		return FALSE;
+	filter_data_buffer(buf, pfn_to_paddr(pfn1), info->page_size);
 
-			filter_data_buffer_parallel(buf, pfn_to_paddr(pfn),
-							info->page_size,
-							&info->filter_mutex);
+	if (!read_pfn_parallel(pw->fd_memory, pfn2, buf + info->page_size,
+			       bitmap_memory, &pw->page_desc_cache,
+			       &pw->mmap_cache))
+		return FALSE;
+	filter_data_buffer(buf + info->page_size, pfn_to_paddr(pfn2),
+			   info->page_size);
 
-			if ((info->dump_level & DL_EXCLUDE_ZERO)
-			    && is_zero_page(buf, info->page_size)) {
-				page_flag_buf->zero = TRUE;
-				goto next;
-			}
+	return memcmp(buf, buf + info->page_size, info->page_size) == 0;
+}
 
-			page_flag_buf->zero = FALSE;
+/*
+ * Take a free slot of page_data_buf from the producer's own slots,
+ * sleeping while all of them are waiting for the consumers.
+ */
+static int
+get_page_data_slot(int thread_num)
+{
+	struct page_data_slots *slots = &PAGE_DATA_SLOTS_PARALLEL(thread_num);
+	unsigned long long mask;
+	int bit;
 
-			/*
-			 * Compress the page data.
-			 */
-			size_out = kdump_thread_args->len_buf_out;
-			if ((info->flag_compress & DUMP_DH_COMPRESSED_ZLIB)
-			    && ((size_out = kdump_thread_args->len_buf_out),
-				compress_mdf(stream, buf_out, &size_out, buf,
-					  info->page_size,
-					  Z_BEST_SPEED) == Z_OK)
-			    && (size_out < info->page_size)) {
-				page_data_buf[index].flags =
-							DUMP_DH_COMPRESSED_ZLIB;
-				page_data_buf[index].size  = size_out;
-				memcpy(page_data_buf[index].buf, buf_out, size_out);
+	while (sem_wait(&slots->free) != 0)
+		;
+
+	/*
+	 * Only the producer clears the bits, so the bit found is still
+	 * set when it is cleared.
+	 */
+	mask = __atomic_load_n(&slots->mask, __ATOMIC_ACQUIRE);
+	bit = __builtin_ctzll(mask);
+	__atomic_fetch_and(&slots->mask, ~(1ULL << bit), __ATOMIC_RELAXED);
+
+	return thread_num * PAGE_DATA_NUM + bit;
+}
+
+/*
+ * Give a slot of page_data_buf back to the producer which owns it.
+ */
+static void
+put_page_data_slot(int index)
+{
+	struct page_data_slots *slots;
+
+	slots = &PAGE_DATA_SLOTS_PARALLEL(index / PAGE_DATA_NUM);
+	__atomic_fetch_or(&slots->mask, 1ULL << (index % PAGE_DATA_NUM),
+			  __ATOMIC_RELEASE);
+	sem_post(&slots->free);
+}
+
+/*
+ * Give the slots which have been written without copying back to
+ * their producers.
+ */
+static void
+release_page_data_slots(int *pending, int *nr_pending)
+{
+	int i;
+
+	for (i = 0; i < *nr_pending; i++)
+		put_page_data_slot(pending[i]);
+	*nr_pending = 0;
+}
+
+static void
+initialize_page_data_slots(int thread_num)
+{
+	struct page_data_slots *slots = &PAGE_DATA_SLOTS_PARALLEL(thread_num);
+
+	slots->mask = PAGE_DATA_NUM < 64 ? (1ULL << PAGE_DATA_NUM) - 1 : ~0ULL;
+	sem_init(&slots->free, 0, PAGE_DATA_NUM);
+}
+
+/*
+ * Get the reorder buffer entry of the writer for the batch seq. The
+ * entry is shared with the batch (seq - info->num_page_batch), so wait
+ * for the writer to finish writing that one.
+ */
+static struct page_batch *
+get_page_batch(struct page_writer *pw, mdf_pfn_t seq)
+{
+	struct page_batch *batch;
+
+	batch = &pw->page_batch[seq % info->num_page_batch];
+	if (__atomic_load_n(&batch->seq, __ATOMIC_ACQUIRE) == seq)
+		return batch;
+
+	pthread_mutex_lock(&info->page_batch_mutex);
+	pthread_cleanup_push(cleanup_mutex, &info->page_batch_mutex);
+	while (batch->seq != seq)
+		pthread_cond_wait(&info->page_batch_cond,
+				  &info->page_batch_mutex);
+	pthread_cleanup_pop(1);
+
+	return batch;
+}
+
+/*
+ * Hand the reorder buffer entry over to the batch seq.
+ */
+static void
+put_page_batch(struct page_batch *batch, mdf_pfn_t seq)
+{
+	batch->nr_pages = 0;
+
+	pthread_mutex_lock(&info->page_batch_mutex);
+	__atomic_store_n(&batch->seq, seq, __ATOMIC_RELEASE);
+	pthread_cond_broadcast(&info->page_batch_cond);
+	pthread_mutex_unlock(&info->page_batch_mutex);
+}
+
+/*
+ * Wait until the next page of the batch is filled or the batch is
+ * finished. Give up after WAIT_TIME seconds.
+ */
+static int
+wait_page_batch(struct page_batch *batch)
+{
+	struct timespec timeout;
+
+	clock_gettime(CLOCK_REALTIME, &timeout);
+	timeout.tv_sec += WAIT_TIME;
+	while (sem_timedwait(&batch->ready, &timeout) != 0) {
+		if (errno != EINTR)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+#ifdef USEURING
+/*
+ * Start reading the run with io_uring if it is contiguous in a PT_LOAD
+ * segment. The other runs are read by read_pfn_range_parallel().
+ */
+static void
+submit_pfn_run(int thread_num, struct pfn_run *run)
+{
+	struct uring_io *io = &URING_IO_PARALLEL(thread_num);
+	off_t offset;
+
+	run->req.len = 0;
+	if (!io->depth || (offset = pfn_range_to_offset(run->pfn, run->nr)) == 0)
+		return;
+
+	run->req.buf    = run->buf;
+	run->req.len    = run->nr * info->page_size;
+	run->req.offset = offset;
+	if (!submit_uring_req(io, &run->req, FD_MEMORY_PARALLEL(thread_num),
+			      FALSE, 0))
+		run->req.len = 0;
+}
+#endif
+
+/*
+ * Claim the next batch of pfns, and find the runs of contiguous
+ * dumpable pfns in it. The runs are packed into buf.
+ */
+static int
+claim_read_batch(int thread_num, struct read_batch *rb, unsigned char *buf,
+		 struct dump_bitmap *bitmap, struct cycle *cycle)
+{
+	struct page_writer *pw;
+	struct pfn_run *run;
+	mdf_pfn_t batch, pfn;
+
+	/*
+	 * The batches of the page writers are claimed in turn, so that
+	 * the dumpfiles of --split are written at the same time. Each
+	 * writer's batches are claimed in order of their sequence numbers.
+	 */
+	do {
+		batch = __atomic_fetch_add(&info->current_batch, 1,
+					   __ATOMIC_RELAXED);
+		if (batch >= info->num_batches)
+			return FALSE;
+		pw = &info->page_writer[batch % info->num_page_writer];
+		rb->seq = batch / info->num_page_writer;
+	} while (rb->seq >= pw->nr_batches);
+
+	pfn = pw->start_pfn + rb->seq * PFN_PER_BATCH;
+	rb->writer = pw;
+	rb->pfn = pfn;
+	rb->end_pfn = MIN(pfn + PFN_PER_BATCH, pw->end_pfn);
+	rb->nr_runs = 0;
+
+	while (pfn < rb->end_pfn) {
+		pfn = find_next_set(bitmap, pfn, rb->end_pfn, cycle);
+		if (pfn >= rb->end_pfn)
+			break;
+
+		run = &rb->run[rb->nr_runs++];
+		run->pfn = pfn;
+		run->buf = buf;
+		run->nr = find_next_zero(bitmap, pfn, rb->end_pfn, cycle) - pfn;
+		pfn += run->nr;
+		buf += run->nr * info->page_size;
+#ifdef USEURING
+		submit_pfn_run(thread_num, run);
+#endif
+	}
+
+	return TRUE;
+}
+
+static int
+read_pfn_run(int thread_num, struct pfn_run *run,
+	     struct dump_bitmap *bitmap_memory_parallel,
+	     struct mmap_cache *mmap_cache)
+{
+#ifdef USEURING
+	struct uring_io *io = &URING_IO_PARALLEL(thread_num);
+
+	if (run->req.len) {
+		/*
+		 * Read the run again if the read was short or failed.
+		 */
+		if (wait_uring_req(io, &run->req)
+		    && run->req.res == run->req.len) {
+			run->req.len = 0;
+			return TRUE;
+		}
+		run->req.len = 0;
+	}
+#endif
+	return read_pfn_range_parallel(FD_MEMORY_PARALLEL(thread_num),
+				       run->pfn, run->nr, run->buf,
+				       bitmap_memory_parallel,
+				       &PAGE_DESC_CACHE_PARALLEL(thread_num),
+				       mmap_cache);
+}
+
+static unsigned long long
+get_time_nsec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * Account the time since t and the bytes to the stage of the
+ * pipeline, and return the current time.
+ */
+static unsigned long long
+account_stage(struct stage_stat *stat, unsigned long long t,
+	      unsigned long long bytes)
+{
+	unsigned long long now = get_time_nsec();
+
+	stat->nsec += now - t;
+	stat->bytes += bytes;
+
+	return now;
+}
+
+/*
+ * Account the compression of nr_pages pages since t to ca, and choose
+ * the compression level for the next COMPRESS_ADAPT_PAGES pages when
+ * they have been compressed. The new level is set to the zlib stream.
+ */
+static void
+account_compress(struct compress_adapt *ca, z_stream *stream,
+		 unsigned long long t, unsigned long nr_pages,
+		 unsigned long size_in, unsigned long size_out)
+{
+	unsigned long long mbps, ratio;
+	int strong;
+
+	ca->nsec += get_time_nsec() - t;
+	ca->size_in += size_in;
+	ca->size_out += size_out;
+	ca->nr_pages += nr_pages;
+	if (ca->nr_pages < COMPRESS_ADAPT_PAGES)
+		return;
+
+	mbps = ca->size_in * 1000 / (ca->nsec ? ca->nsec : 1);
+	ratio = ca->size_out * 100 / ca->size_in;
+	strong = ca->strong;
+
+	if (!ca->strong) {
+		if (ca->hold)
+			ca->hold--;
+		else if (mbps >= info->compress_budget * COMPRESS_COST_STRONG
+			 && ratio <= COMPRESS_RATIO_STRONG)
+			strong = TRUE;
+	} else if (mbps < info->compress_budget) {
+		strong = FALSE;
+		ca->hold = COMPRESS_ADAPT_HOLD;
+	} else if (ratio > COMPRESS_RATIO_STRONG) {
+		strong = FALSE;
+	}
+
+	if (strong != ca->strong) {
+		DEBUG_MSG("compress: %s level at %lluMB/s, %llu%% of the pages\n",
+			  strong ? "strong" : "fast", mbps, ratio);
+		ca->strong = strong;
+		if (stream && (info->flag_compress & DUMP_DH_COMPRESSED_ZLIB))
+			deflateParams(stream, strong ? ZLIB_LEVEL_STRONG
+					      : COMPRESS_LEVEL_FAST,
+				      Z_DEFAULT_STRATEGY);
+	}
+
+	ca->nsec = 0;
+	ca->size_in = 0;
+	ca->size_out = 0;
+	ca->nr_pages = 0;
+}
+
+void *
+kdump_thread_function_cyclic(void *arg) {
+	void *retval = PTHREAD_FAIL;
+	struct thread_args *kdump_thread_args = (struct thread_args *)arg;
+	volatile struct page_data *page_data_buf = kdump_thread_args->page_data_buf;
+	struct stage_stat *stage_stat =
+		STAGE_STAT_PARALLEL(kdump_thread_args->thread_num);
+	struct compress_adapt *ca =
+		&COMPRESS_ADAPT_PARALLEL(kdump_thread_args->thread_num);
+	struct page_batch *batch;
+	struct page_flag *page_flag;
+	struct cycle *cycle = kdump_thread_args->cycle;
+	struct read_batch read_batch[2];
+	struct read_batch *rb;
+	struct pfn_run *run;
+	mdf_pfn_t pfn, i;
+	unsigned long long t, t_compress = 0;
+	int index = -1, incompressible;
+	int cur = 0, have_next = FALSE, prefetch = FALSE, r;
+	struct dump_bitmap bitmap_parallel = {0};
+	struct dump_bitmap bitmap_memory_parallel = {.fd = -1};
+	struct dump_bitmap *bitmap;
+	unsigned char *buf = NULL, *page, *out;
+	struct mmap_cache *mmap_cache =
+			MMAP_CACHE_PARALLEL(kdump_thread_args->thread_num);
+	unsigned long size_out;
+	z_stream *stream = &ZLIB_STREAM_PARALLEL(kdump_thread_args->thread_num);
+#ifdef USELZO
+	lzo_bytep wrkmem = WRKMEM_PARALLEL(kdump_thread_args->thread_num);
+#endif
+#ifdef USEZSTD
+	ZSTD_CCtx *cctx = ZSTD_CCTX_PARALLEL(kdump_thread_args->thread_num);
+#endif
+
+	buf = BUF_PARALLEL(kdump_thread_args->thread_num);
+
+	memset(stage_stat, 0, sizeof(struct stage_stat) * NR_STAGES);
+
+#ifdef USEURING
+	/*
+	 * With io_uring, read the next batch while processing the
+	 * current one.
+	 */
+	prefetch = URING_IO_PARALLEL(kdump_thread_args->thread_num).depth != 0;
+#endif
+
+	if (info->fd_bitmap >= 0) {
+		bitmap_parallel.buf = malloc(BUFSIZE_BITMAP);
+		if (bitmap_parallel.buf == NULL){
+			ERRMSG("Can't allocate memory for bitmap_parallel.buf. %s\n",
+			strerror(errno));
+			goto fail;
+		}
+		initialize_2nd_bitmap_parallel(&bitmap_parallel,
+					kdump_thread_args->thread_num);
+	}
+	bitmap = info->fd_bitmap >= 0 ? &bitmap_parallel : info->bitmap2;
+
+	if (info->flag_refiltering) {
+		bitmap_memory_parallel.buf = malloc(BUFSIZE_BITMAP);
+		if (bitmap_memory_parallel.buf == NULL){
+			ERRMSG("Can't allocate memory for bitmap_memory_parallel.buf. %s\n",
+			strerror(errno));
+			goto fail;
+		}
+		initialize_bitmap_memory_parallel(&bitmap_memory_parallel,
+						kdump_thread_args->thread_num);
+	}
+
+	/*
+	 * Each thread claims PFN_PER_BATCH pfns at a time from
+	 * info->current_batch without a lock, and takes slots of
+	 * page_data_buf only from its own page_data_slots.
+	 * The runs of contiguous dumpable pfns in the batch are read
+	 * and filtered at once, and then their pages are compressed
+	 * one by one.
+	 *
+	 * filtered page won't take anything
+	 * unfiltered zero page will only take an entry of page_batch
+	 * unfiltered non-zero page will take an entry of page_batch
+	 * and a page_data_buf
+	 */
+	if (!claim_read_batch(kdump_thread_args->thread_num, &read_batch[cur],
+			      buf, bitmap, cycle))
+		goto done;
+
+	while (1) {
+		if (prefetch)
+			have_next = claim_read_batch(kdump_thread_args->thread_num,
+					&read_batch[!cur],
+					buf + !cur * PFN_PER_BATCH
+					      * info->page_size,
+					bitmap, cycle);
+
+		rb = &read_batch[cur];
+		batch = get_page_batch(rb->writer, rb->seq);
+
+		for (r = 0; r < rb->nr_runs; r++) {
+			run = &rb->run[r];
+
+			t = get_time_nsec();
+			if (!read_pfn_run(kdump_thread_args->thread_num, run,
+					  &bitmap_memory_parallel, mmap_cache))
+				goto fail;
+			t = account_stage(&stage_stat[STAGE_READ], t,
+					  run->nr * info->page_size);
+
+			filter_split_data_buffer(run->buf, pfn_to_paddr(run->pfn),
+						 run->nr * info->page_size,
+						 rb->writer - info->page_writer);
+			account_stage(&stage_stat[STAGE_FILTER], t,
+				      run->nr * info->page_size);
+
+			for (i = 0, pfn = run->pfn; i < run->nr; i++, pfn++) {
+				page = run->buf + i * info->page_size;
+
+				if (index < 0)
+					index = get_page_data_slot(
+						kdump_thread_args->thread_num);
+
+				t = get_time_nsec();
+				page_flag = &batch->page[batch->nr_pages];
+				page_flag->pfn = pfn;
+
+				page_flag->zero = FALSE;
+				page_flag->filled = FALSE;
+				page_flag->dup = NULL;
+
+				if ((info->dump_level & DL_EXCLUDE_ZERO)
+				    && is_zero_page(page, info->page_size)) {
+					page_flag->zero = TRUE;
+					goto next;
+				}
+
+				if (info->flag_same_filled
+				    && is_filled_page(page, info->page_size,
+						      &page_flag->fill)) {
+					page_flag->filled = TRUE;
+					goto next;
+				}
+
+				/*
+				 * Skip compressing the page identical to one
+				 * the writer has written.
+				 */
+				if (info->flag_dedup) {
+					hash_page(page, info->page_size,
+						  &page_flag->hash,
+						  &page_flag->check);
+					page_flag->dup = lookup_dedup_entry(
+							rb->writer->dedup_table,
+							page_flag->hash,
+							page_flag->check);
+					if (page_flag->dup
+					    && !is_same_page_parallel(
+							kdump_thread_args->thread_num,
+							page_flag->dup->pfn, page,
+							page_data_buf[index].buf,
+							&bitmap_memory_parallel,
+							mmap_cache))
+						page_flag->dup = NULL;
+					if (page_flag->dup)
+						goto next;
+				}
+
+				/*
+				 * Compress the page data into page_data_buf
+				 * directly, the consumer writes it from there.
+				 * With --compress-budget, the page which looks
+				 * incompressible is stored as it is.
+				 */
+				out = page_data_buf[index].buf;
+				size_out = kdump_thread_args->len_buf_out;
+				incompressible = info->compress_budget
+				    && is_incompressible_page(page,
+							      info->page_size);
+				if (info->compress_budget)
+					t_compress = get_time_nsec();
+				if (incompressible) {
+					page_data_buf[index].flags = 0;
+					page_data_buf[index].size  = info->page_size;
+					memcpy(out, page, info->page_size);
+				} else if ((info->flag_compress & DUMP_DH_COMPRESSED_ZLIB)
+				    && ((size_out = kdump_thread_args->len_buf_out),
+					compress_mdf(stream, out, &size_out, page,
+						  info->page_size,
+						  Z_BEST_SPEED) == Z_OK)
+				    && (size_out < info->page_size)) {
+					page_data_buf[index].flags =
+								DUMP_DH_COMPRESSED_ZLIB;
+					page_data_buf[index].size  = size_out;
 #ifdef USELZO
-			} else if (info->flag_lzo_support
-				   && (info->flag_compress
-				       & DUMP_DH_COMPRESSED_LZO)
-				   && ((size_out = info->page_size),
-				       lzo1x_1_compress(buf, info->page_size,
-							buf_out, &size_out,
-							wrkmem) == LZO_E_OK)
-				   && (size_out < info->page_size)) {
-				page_data_buf[index].flags =
-							DUMP_DH_COMPRESSED_LZO;
-				page_data_buf[index].size  = size_out;
-				memcpy(page_data_buf[index].buf, buf_out, size_out);
+				} else if (info->flag_lzo_support
+					   && (info->flag_compress
+					       & DUMP_DH_COMPRESSED_LZO)
+					   && ((size_out = info->page_size),
+					       lzo1x_1_compress(page, info->page_size,
+								out, &size_out,
+								wrkmem) == LZO_E_OK)
+					   && (size_out < info->page_size)) {
+					page_data_buf[index].flags =
+								DUMP_DH_COMPRESSED_LZO;
+					page_data_buf[index].size  = size_out;
 #endif
 #ifdef USESNAPPY
-			} else if ((info->flag_compress
-				    & DUMP_DH_COMPRESSED_SNAPPY)
-				   && ((size_out = kdump_thread_args->len_buf_out),
-				       snappy_compress((char *)buf,
-						       info->page_size,
-						       (char *)buf_out,
-						       (size_t *)&size_out)
-				       == SNAPPY_OK)
-				   && (size_out < info->page_size)) {
-				page_data_buf[index].flags =
+				} else if ((info->flag_compress
+					    & DUMP_DH_COMPRESSED_SNAPPY)
+					   && ((size_out = kdump_thread_args->len_buf_out),
+					       snappy_compress((char *)page,
+							       info->page_size,
+							       (char *)out,
+							       (size_t *)&size_out)
+					       == SNAPPY_OK)
+					   && (size_out < info->page_size)) {
+					page_data_buf[index].flags =
 						DUMP_DH_COMPRESSED_SNAPPY;
-				page_data_buf[index].size  = size_out;
-				memcpy(page_data_buf[index].buf, buf_out, size_out);
+					page_data_buf[index].size  = size_out;
 #endif
 #ifdef USEZSTD
-			} else if ((info->flag_compress & DUMP_DH_COMPRESSED_ZSTD)
-				   && (size_out = ZSTD_compressCCtx(cctx,
-						buf_out, kdump_thread_args->len_buf_out,
-						buf, info->page_size, 1))
-				   && (!ZSTD_isError(size_out))
-				   && (size_out < info->page_size)) {
-				page_data_buf[index].flags = DUMP_DH_COMPRESSED_ZSTD;
-				page_data_buf[index].size  = size_out;
-				memcpy(page_data_buf[index].buf, buf_out, size_out);
+				} else if ((info->flag_compress & DUMP_DH_COMPRESSED_ZSTD)
+					   && (size_out = compress_zstd(cctx,
+							out, kdump_thread_args->len_buf_out,
+							page, info->page_size, ca))
+					   && (!ZSTD_isError(size_out))
+					   && (size_out < info->page_size)) {
+					page_data_buf[index].flags = DUMP_DH_COMPRESSED_ZSTD;
+					page_data_buf[index].size  = size_out;
 #endif
-			} else {
-				page_data_buf[index].flags = 0;
-				page_data_buf[index].size  = info->page_size;
-				memcpy(page_data_buf[index].buf, buf, info->page_size);
-			}
-			page_flag_buf->index = index;
-			buf_ready = TRUE;
+#ifdef USELZ4
+				} else if ((info->flag_compress & DUMP_DH_COMPRESSED_LZ4)
+					   && (size_out = LZ4_compress_default(
+							(char *)page, (char *)out,
+							info->page_size,
+							kdump_thread_args->len_buf_out))
+					   && (size_out < info->page_size)) {
+					page_data_buf[index].flags = DUMP_DH_COMPRESSED_LZ4;
+					page_data_buf[index].size  = size_out;
+#endif
+				} else {
+					page_data_buf[index].flags = 0;
+					page_data_buf[index].size  = info->page_size;
+					memcpy(out, page, info->page_size);
+				}
+				if (info->compress_budget && !incompressible)
+					account_compress(ca, stream, t_compress,
+						1, info->page_size,
+						page_data_buf[index].size);
+				page_flag->index = index;
+				index = -1;
 next:
-			page_flag_buf->ready = FLAG_READY;
-			page_flag_buf = page_flag_buf->next;
-
+				account_stage(&stage_stat[STAGE_COMPRESS], t,
+					      info->page_size);
+				__atomic_store_n(&batch->nr_pages,
+						 batch->nr_pages + 1,
+						 __ATOMIC_RELEASE);
+				sem_post(&batch->ready);
+			}
 		}
+
+		/*
+		 * Tell the consumer that the batch is finished.
+		 */
+		sem_post(&batch->ready);
+
+		if (prefetch) {
+			if (!have_next)
+				break;
+			cur = !cur;
+		} else if (!claim_read_batch(kdump_thread_args->thread_num,
+					     &read_batch[cur], buf, bitmap,
+					     cycle))
+			break;
 	}
+done:
 	retval = NULL;
 
 fail:
+#ifdef USEURING
+	if (prefetch)
+		drain_uring_io(&URING_IO_PARALLEL(kdump_thread_args->thread_num));
+#endif
 	if (bitmap_memory_parallel.fd >= 0)
 		close(bitmap_memory_parallel.fd);
 	if (bitmap_parallel.buf != NULL)
@@ -8613,80 +11446,323 @@ fail:
 	pthread_exit(retval);
 }
 
-int
-write_kdump_pages_parallel_cyclic(struct cache_data *cd_header,
-				  struct cache_data *cd_page,
-				  struct page_desc *pd_zero,
-				  off_t *offset_data, struct cycle *cycle)
+/*
+ * Print the progress of writing pages. With several page writers, the
+ * one which gets the lock prints it.
+ */
+static void
+print_copy_progress(struct timespec *ts_start)
+{
+	static pthread_mutex_t progress_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+	if (pthread_mutex_trylock(&progress_mutex) != 0)
+		return;
+	print_progress(PROGRESS_COPY, num_dumped, info->num_dumpable, ts_start);
+	pthread_mutex_unlock(&progress_mutex);
+}
+
+/*
+ * Write the batches of the page writer in order of their sequence
+ * numbers, and the pages of each batch in order of filling, so the
+ * pages are written in pfn order without searching.
+ */
+static int
+write_page_batches(struct page_writer *pw)
+{
+	struct cache_data *cd_header = pw->cd_header;
+	struct cache_data *cd_page = pw->cd_page;
+	struct page_data *page_data_buf = info->page_data_buf;
+	struct page_batch *batch;
+	struct page_flag *page_flag;
+	struct dedup_entry *entry;
+	struct page_desc pd;
+	unsigned long long t;
+	unsigned char *dedup_buf = NULL;
+	struct dump_bitmap bitmap_memory = {.fd = -1};
+	mdf_pfn_t seq, per;
+	int i, index;
+	int zero_copy = TRUE;
+	int pending[CACHE_IOV_NUM];
+	int nr_pending = 0;
+	int ret = FALSE;
+
+#ifdef USEURING
+	/*
+	 * The asynchronous flushes of cd_page need their own copy.
+	 */
+	zero_copy = !cd_page->uring;
+#endif
+
+	if (info->flag_dedup
+	    && (dedup_buf = malloc(info->page_size * 2)) == NULL) {
+		ERRMSG("Can't allocate memory for the dedup buffer. %s\n",
+		       strerror(errno));
+		return FALSE;
+	}
+	if (info->flag_dedup && info->flag_refiltering) {
+		bitmap_memory.buf = malloc(BUFSIZE_BITMAP);
+		if (bitmap_memory.buf == NULL) {
+			ERRMSG("Can't allocate memory for bitmap_memory.buf. %s\n",
+			       strerror(errno));
+			free(dedup_buf);
+			return FALSE;
+		}
+		bitmap_memory.fd        = pw->fd_bitmap_memory;
+		bitmap_memory.file_name = info->name_memory;
+		bitmap_memory.no_block  = -1;
+		bitmap_memory.offset    = info->bitmap_memory->offset;
+	}
+
+	per = info->num_dumpable / 10000;
+	per = per ? per : 1;
+
+	for (seq = 0; seq < pw->nr_batches; seq++) {
+		batch = &pw->page_batch[seq % info->num_page_batch];
+
+		for (i = 0; ; i++) {
+			if (sem_trywait(&batch->ready) != 0) {
+				/*
+				 * The producer may be waiting for the slots
+				 * which cd_page refers to.
+				 */
+				if (nr_pending) {
+					t = get_time_nsec();
+					if (!write_cache_bufsz(cd_page))
+						goto out;
+					release_page_data_slots(pending,
+								&nr_pending);
+					account_stage(&pw->stage_stat, t, 0);
+				}
+				if (!wait_page_batch(batch)) {
+					ERRMSG("Can't get data of pfn.\n");
+					goto out;
+				}
+			}
+			if (i >= __atomic_load_n(&batch->nr_pages,
+						 __ATOMIC_ACQUIRE))
+				break;
+
+			page_flag = &batch->page[i];
+
+			if ((__atomic_fetch_add(&num_dumped, 1,
+						__ATOMIC_RELAXED) % per) == 0)
+				print_copy_progress(pw->ts_start);
+
+			t = get_time_nsec();
+			if (page_flag->zero == TRUE) {
+				if (!write_cache(cd_header, pw->pd_zero,
+						 sizeof(page_desc_t)))
+					goto out;
+				__atomic_fetch_add(&pfn_zero, 1,
+						   __ATOMIC_RELAXED);
+				account_stage(&pw->stage_stat, t,
+					      sizeof(page_desc_t));
+			} else if (page_flag->filled == TRUE) {
+				pd.flags      = DUMP_DH_FILLED_PAGE;
+				pd.size       = 0;
+				pd.page_flags = 0;
+				pd.offset     = page_flag->fill;
+				if (!write_cache(cd_header, &pd, sizeof(page_desc_t)))
+					goto out;
+				account_stage(&pw->stage_stat, t,
+					      sizeof(page_desc_t));
+			} else if (page_flag->dup != NULL) {
+				set_dedup_page_desc(&pd, page_flag->dup);
+				if (!write_cache(cd_header, &pd, sizeof(page_desc_t)))
+					goto out;
+				account_stage(&pw->stage_stat, t,
+					      sizeof(page_desc_t));
+			} else if (info->flag_dedup
+				   && (entry = lookup_dedup_entry(pw->dedup_table,
+							page_flag->hash,
+							page_flag->check))
+				   && is_same_pfn(pw, page_flag->pfn, entry->pfn,
+						  dedup_buf, &bitmap_memory)) {
+				/*
+				 * The page was compressed at the same time as
+				 * the identical one, and is not written.
+				 */
+				set_dedup_page_desc(&pd, entry);
+				if (!write_cache(cd_header, &pd, sizeof(page_desc_t)))
+					goto out;
+				put_page_data_slot(page_flag->index);
+				account_stage(&pw->stage_stat, t,
+					      sizeof(page_desc_t));
+			} else {
+				index = page_flag->index;
+				pd.flags      = page_data_buf[index].flags;
+				pd.size       = page_data_buf[index].size;
+				pd.page_flags = 0;
+				pd.offset     = *pw->offset_data;
+				*pw->offset_data += pd.size;
+				/*
+				 * Write the page header.
+				 */
+				if (!write_cache(cd_header, &pd, sizeof(page_desc_t)))
+					goto out;
+				/*
+				 * Write the page data. Without copying, the
+				 * slot is given back after it is written.
+				 */
+				if (zero_copy) {
+					pending[nr_pending++] = index;
+					if (!write_cache_iov(cd_page,
+							     page_data_buf[index].buf,
+							     pd.size))
+						goto out;
+					if (!cd_page->nr_iov)
+						release_page_data_slots(pending,
+									&nr_pending);
+				} else {
+					if (!write_cache(cd_page,
+							 page_data_buf[index].buf,
+							 pd.size))
+						goto out;
+					put_page_data_slot(index);
+				}
+				if (info->flag_dedup)
+					add_dedup_entry(pw->dedup_table,
+							page_flag->hash,
+							page_flag->check,
+							page_flag->pfn, &pd);
+				account_stage(&pw->stage_stat, t,
+					      sizeof(page_desc_t) + pd.size);
+			}
+		}
+		put_page_batch(batch, seq + info->num_page_batch);
+	}
+
+	/*
+	 * page_data_buf is reused in the next cycle.
+	 */
+	if (nr_pending) {
+		if (!write_cache_bufsz(cd_page))
+			goto out;
+		release_page_data_slots(pending, &nr_pending);
+	}
+	ret = TRUE;
+out:
+	if (cd_page->nr_iov) {
+		cd_page->buf_size = 0;
+		cd_page->nr_iov = 0;
+	}
+	free(dedup_buf);
+	free(bitmap_memory.buf);
+
+	return ret;
+}
+
+static void *
+page_writer_thread_function(void *arg)
+{
+	struct page_writer *pw = (struct page_writer *)arg;
+
+	void *retval = NULL;
+
+	if (!write_page_batches(pw)) {
+		pw->ret = FALSE;
+		retval = PTHREAD_FAIL;
+	}
+	sem_post(&info->page_writer_done);
+
+	pthread_exit(retval);
+}
+
+/*
+ * Set up the page writer for the pages of [start_pfn, end_pfn) in the
+ * cycle.
+ */
+static void
+set_page_writer(struct page_writer *pw, struct cache_data *cd_header,
+		struct cache_data *cd_page, struct page_desc *pd_zero,
+		off_t *offset_data, struct dedup_entry *dedup_table,
+		mdf_pfn_t start_pfn, mdf_pfn_t end_pfn, struct cycle *cycle)
+{
+	pw->cd_header   = cd_header;
+	pw->cd_page     = cd_page;
+	pw->pd_zero     = pd_zero;
+	pw->offset_data = offset_data;
+	pw->dedup_table = dedup_table;
+	pw->start_pfn   = MAX(start_pfn, cycle->start_pfn);
+	pw->end_pfn     = MIN(end_pfn, cycle->end_pfn);
+	if (pw->end_pfn < pw->start_pfn)
+		pw->end_pfn = pw->start_pfn;
+	pw->nr_batches  = divideup(pw->end_pfn - pw->start_pfn, PFN_PER_BATCH);
+}
+
+/*
+ * Write the pages of the cycle with the page writers set up in
+ * info->page_writer. The producer threads read and compress the pages,
+ * and the writers write them.
+ */
+static int
+write_kdump_pages_parallel(struct cycle *cycle)
 {
 	int ret = FALSE;
 	int res;
 	unsigned long len_buf_out;
-	mdf_pfn_t per;
-	mdf_pfn_t start_pfn, end_pfn;
-	struct page_desc pd;
+	mdf_pfn_t max_batches = 0;
 	struct timespec ts_start;
-	struct timespec last, new;
 	pthread_t **threads = NULL;
 	struct thread_args *kdump_thread_args = NULL;
 	void *thread_result;
-	int page_buf_num;
 	struct page_data *page_data_buf = NULL;
-	int i;
-	int index;
-	int end_count, consuming;
-	mdf_pfn_t current_pfn, temp_pfn;
-
-	if (info->flag_elf_dumpfile)
-		return FALSE;
+	struct page_writer *pw;
+	int nr_writers = 0;
+	int i, j;
 
-	res = pthread_mutex_init(&info->current_pfn_mutex, NULL);
+	res = pthread_rwlock_init(&info->usemmap_rwlock, NULL);
 	if (res != 0) {
-		ERRMSG("Can't initialize current_pfn_mutex. %s\n",
-				strerror(res));
+		ERRMSG("Can't initialize usemmap_rwlock. %s\n", strerror(res));
 		goto out;
 	}
 
-	res = pthread_mutex_init(&info->filter_mutex, NULL);
+	res = pthread_mutex_init(&info->page_batch_mutex, NULL);
 	if (res != 0) {
-		ERRMSG("Can't initialize filter_mutex. %s\n", strerror(res));
+		ERRMSG("Can't initialize page_batch_mutex. %s\n", strerror(res));
 		goto out;
 	}
 
-	res = pthread_rwlock_init(&info->usemmap_rwlock, NULL);
+	res = pthread_cond_init(&info->page_batch_cond, NULL);
 	if (res != 0) {
-		ERRMSG("Can't initialize usemmap_rwlock. %s\n", strerror(res));
+		ERRMSG("Can't initialize page_batch_cond. %s\n", strerror(res));
 		goto out;
 	}
 
-	len_buf_out = calculate_len_buf_out(info->page_size);
+	sem_init(&info->page_writer_done, 0, 0);
 
-	per = info->num_dumpable / 10000;
-	per = per ? per : 1;
+	len_buf_out = calculate_len_buf_out(info->page_size);
 
 	clock_gettime(CLOCK_MONOTONIC, &ts_start);
 
-	start_pfn = cycle->start_pfn;
-	end_pfn   = cycle->end_pfn;
+	for (i = 0; i < info->num_page_writer; i++) {
+		pw = &info->page_writer[i];
+		pw->page_batch = info->page_batch + i * info->num_page_batch;
+		pw->ts_start = &ts_start;
+		memset(&pw->stage_stat, 0, sizeof(pw->stage_stat));
+		max_batches = MAX(max_batches, pw->nr_batches);
 
-	info->current_pfn = start_pfn;
+		for (j = 0; j < info->num_page_batch; j++) {
+			pw->page_batch[j].seq = j;
+			pw->page_batch[j].nr_pages = 0;
+			sem_init(&pw->page_batch[j].ready, 0, 0);
+		}
+	}
+	info->current_batch = 0;
+	info->num_batches = max_batches * info->num_page_writer;
 
 	threads = info->threads;
 	kdump_thread_args = info->kdump_thread_args;
 
-	page_buf_num = info->num_buffers;
 	page_data_buf = info->page_data_buf;
-	pthread_mutex_init(&info->page_data_mutex, NULL);
-	sem_init(&info->page_flag_buf_sem, 0, 0);
 
-	for (i = 0; i < page_buf_num; i++)
-		page_data_buf[i].used = FALSE;
+	for (i = 0; i < info->num_threads; i++)
+		initialize_page_data_slots(i);
 
 	for (i = 0; i < info->num_threads; i++) {
 		kdump_thread_args[i].thread_num = i;
 		kdump_thread_args[i].len_buf_out = len_buf_out;
 		kdump_thread_args[i].page_data_buf = page_data_buf;
-		kdump_thread_args[i].page_flag_buf = info->page_flag_buf[i];
 		kdump_thread_args[i].cycle = cycle;
 
 		res = pthread_create(threads[i], NULL,
@@ -8699,107 +11775,45 @@ write_kdump_pages_parallel_cyclic(struct cache_data *cd_header,
 		}
 	}
 
-	end_count = 0;
-	while (1) {
-		consuming = 0;
+	/*
+	 * The basic idea is producer producing page and consumer writing page.
+	 * Producers claim batches of PFN_PER_BATCH pfns and fill the entry of
+	 * the page writer's page_batch[] for the batch with its dumpable pages.
+	 * The main thread is the only page writer, except with --split, where
+	 * a thread for each dumpfile writes it and the main thread waits for
+	 * all of them.
+	 */
+	if (info->num_page_writer == 1) {
+		if (!write_page_batches(&info->page_writer[0]))
+			goto out;
+	} else {
+		for (nr_writers = 0; nr_writers < info->num_page_writer;
+		     nr_writers++) {
+			pw = &info->page_writer[nr_writers];
+			pw->ret = TRUE;
+			res = pthread_create(&pw->thread, NULL,
+					     page_writer_thread_function, pw);
+			if (res != 0) {
+				ERRMSG("Can't create the page writer %d. %s\n",
+				       nr_writers, strerror(res));
+				goto out;
+			}
+		}
 
 		/*
-		 * The basic idea is producer producing page and consumer writing page.
-		 * Each producer have a page_flag_buf list which is used for storing page's description.
-		 * The size of page_flag_buf is little so it won't take too much memory.
-		 * And all producers will share a page_data_buf array which is used for storing page's compressed data.
-		 * The main thread is the consumer. It will find the next pfn and write it into file.
-		 * The next pfn is smallest pfn in all page_flag_buf.
+		 * Stop at the first writer which fails. The others may be
+		 * waiting for pages which never come, and are cancelled.
 		 */
-		sem_wait(&info->page_flag_buf_sem);
-		clock_gettime(CLOCK_MONOTONIC, &last);
-		while (1) {
-			current_pfn = end_pfn;
-
-			/*
-			 * page_flag_buf is in circular linked list.
-			 * The array info->page_flag_buf[] records the current page_flag_buf in each thread's
-			 * page_flag_buf list.
-			 * consuming is used for recording in which thread the pfn is the smallest.
-			 * current_pfn is used for recording the value of pfn when checking the pfn.
-			 */
-			for (i = 0; i < info->num_threads; i++) {
-				if (info->page_flag_buf[i]->ready == FLAG_UNUSED)
-					continue;
-				temp_pfn = info->page_flag_buf[i]->pfn;
-
-				/*
-				 * count how many threads have reached the end.
-				 */
-				if (temp_pfn >= end_pfn) {
-					info->page_flag_buf[i]->ready = FLAG_UNUSED;
-					end_count++;
-					continue;
-				}
-
-				if (current_pfn < temp_pfn)
-					continue;
-
-				consuming = i;
-				current_pfn = temp_pfn;
-			}
-
-			/*
-			 * If all the threads have reached the end, we will finish writing.
-			 */
-			if (end_count >= info->num_threads)
-				goto finish;
-
-			/*
-			 * If the page_flag_buf is not ready, the pfn recorded may be changed.
-			 * So we should recheck.
-			 */
-			if (info->page_flag_buf[consuming]->ready != FLAG_READY) {
-				clock_gettime(CLOCK_MONOTONIC, &new);
-				if (new.tv_sec - last.tv_sec > WAIT_TIME) {
-					ERRMSG("Can't get data of pfn.\n");
+		for (i = 0; i < nr_writers; i++) {
+			while (sem_wait(&info->page_writer_done) != 0)
+				;
+			for (j = 0; j < nr_writers; j++) {
+				if (info->page_writer[j].ret == FALSE)
 					goto out;
-				}
-				continue;
 			}
-
-			if (current_pfn == info->page_flag_buf[consuming]->pfn)
-				break;
 		}
-
-		if ((num_dumped % per) == 0)
-			print_progress(PROGRESS_COPY, num_dumped, info->num_dumpable, &ts_start);
-
-		num_dumped++;
-
-
-		if (info->page_flag_buf[consuming]->zero == TRUE) {
-			if (!write_cache(cd_header, pd_zero, sizeof(page_desc_t)))
-				goto out;
-			pfn_zero++;
-		} else {
-			index = info->page_flag_buf[consuming]->index;
-			pd.flags      = page_data_buf[index].flags;
-			pd.size       = page_data_buf[index].size;
-			pd.page_flags = 0;
-			pd.offset     = *offset_data;
-			*offset_data  += pd.size;
-			/*
-			 * Write the page header.
-			 */
-			if (!write_cache(cd_header, &pd, sizeof(page_desc_t)))
-				goto out;
-			/*
-			 * Write the page data.
-			 */
-			if (!write_cache(cd_page, page_data_buf[index].buf, pd.size))
-				goto out;
-			page_data_buf[index].used = FALSE;
-		}
-		info->page_flag_buf[consuming]->ready = FLAG_UNUSED;
-		info->page_flag_buf[consuming] = info->page_flag_buf[consuming]->next;
 	}
-finish:
+
 	ret = TRUE;
 	/*
 	 * print [100 %]
@@ -8833,18 +11847,200 @@ out:
 				else
 					DEBUG_MSG("Thread %d finishes.\n", i);
 
+				for (j = 0; j < NR_STAGES; j++) {
+					info->stage_stat[j].nsec +=
+						STAGE_STAT_PARALLEL(i)[j].nsec;
+					info->stage_stat[j].bytes +=
+						STAGE_STAT_PARALLEL(i)[j].bytes;
+				}
 			}
 		}
 	}
 
-	sem_destroy(&info->page_flag_buf_sem);
+	for (i = 0; i < nr_writers; i++) {
+		pw = &info->page_writer[i];
+		res = pthread_cancel(pw->thread);
+		if (res != 0 && res != ESRCH)
+			ERRMSG("Can't cancel the page writer %d. %s\n",
+			       i, strerror(res));
+		res = pthread_join(pw->thread, &thread_result);
+		if (res != 0)
+			ERRMSG("Can't join with the page writer %d. %s\n",
+			       i, strerror(res));
+	}
+
+	for (i = 0; i < info->num_page_writer; i++) {
+		pw = &info->page_writer[i];
+		info->stage_stat[STAGE_WRITE].nsec += pw->stage_stat.nsec;
+		info->stage_stat[STAGE_WRITE].bytes += pw->stage_stat.bytes;
+		for (j = 0; j < info->num_page_batch; j++)
+			sem_destroy(&pw->page_batch[j].ready);
+	}
+	for (i = 0; i < info->num_threads; i++)
+		sem_destroy(&PAGE_DATA_SLOTS_PARALLEL(i).free);
+	sem_destroy(&info->page_writer_done);
+	pthread_cond_destroy(&info->page_batch_cond);
+	pthread_mutex_destroy(&info->page_batch_mutex);
 	pthread_rwlock_destroy(&info->usemmap_rwlock);
-	pthread_mutex_destroy(&info->filter_mutex);
-	pthread_mutex_destroy(&info->current_pfn_mutex);
 
 	return ret;
 }
 
+/*
+ * Compress the pages of ext as one frame into ext->buf_out.
+ * Return the compression flag, or 0 if the frame is not compressed.
+ */
+static int
+compress_extent(struct extent *ext, unsigned long *size_out)
+{
+	unsigned long len = ext->nr * info->page_size;
+
+	if ((info->flag_compress & DUMP_DH_COMPRESSED_ZLIB)
+	    && ((*size_out = ext->len_buf_out),
+		compress_mdf(ext->stream, ext->buf_out, size_out,
+			     ext->buf, len, Z_BEST_SPEED) == Z_OK)
+	    && (*size_out < len))
+		return DUMP_DH_COMPRESSED_ZLIB;
+#ifdef USELZO
+	if (info->flag_lzo_support
+	    && (info->flag_compress & DUMP_DH_COMPRESSED_LZO)
+	    && ((*size_out = len),
+		lzo1x_1_compress(ext->buf, len, ext->buf_out, size_out,
+				 ext->wrkmem) == LZO_E_OK)
+	    && (*size_out < len))
+		return DUMP_DH_COMPRESSED_LZO;
+#endif
+#ifdef USESNAPPY
+	if ((info->flag_compress & DUMP_DH_COMPRESSED_SNAPPY)
+	    && ((*size_out = ext->len_buf_out),
+		snappy_compress((char *)ext->buf, len, (char *)ext->buf_out,
+				(size_t *)size_out) == SNAPPY_OK)
+	    && (*size_out < len))
+		return DUMP_DH_COMPRESSED_SNAPPY;
+#endif
+#ifdef USEZSTD
+	if ((info->flag_compress & DUMP_DH_COMPRESSED_ZSTD)
+	    && (*size_out = compress_zstd(ext->cctx, ext->buf_out,
+					  ext->len_buf_out, ext->buf, len,
+					  &info->compress_adapt))
+	    && (!ZSTD_isError(*size_out))
+	    && (*size_out < len))
+		return DUMP_DH_COMPRESSED_ZSTD;
+#endif
+#ifdef USELZ4
+	if ((info->flag_compress & DUMP_DH_COMPRESSED_LZ4)
+	    && (*size_out = LZ4_compress_default((char *)ext->buf,
+						 (char *)ext->buf_out, len,
+						 ext->len_buf_out))
+	    && (*size_out < len))
+		return DUMP_DH_COMPRESSED_LZ4;
+#endif
+	return 0;
+}
+
+/*
+ * Write the page descriptors held in ext, and the pages of ext as a
+ * frame. Every page of a compressed frame has the offset and the size
+ * of the whole frame, and its index in page_flags. If the frame does
+ * not get smaller, its pages are written one by one uncompressed.
+ */
+static int
+write_extent(struct cache_data *cd_header, struct cache_data *cd_page,
+	     struct extent *ext, off_t *offset_data)
+{
+	struct page_desc *pd;
+	unsigned long size_out = 0;
+	unsigned long long index, t;
+	int i, flags = 0;
+
+	if (ext->nr) {
+		t = get_time_nsec();
+		flags = compress_extent(ext, &size_out);
+		if (info->compress_budget)
+			account_compress(&info->compress_adapt, ext->stream, t,
+					 ext->nr, ext->nr * info->page_size,
+					 flags ? size_out
+					       : ext->nr * info->page_size);
+	}
+
+	for (i = 0; i < ext->nr_pd; i++) {
+		pd = &ext->pd[i];
+		if (!(pd->flags & DUMP_DH_EXTENT)) {
+			if (!write_cache(cd_header, pd, sizeof(page_desc_t)))
+				return FALSE;
+			continue;
+		}
+
+		index = pd->page_flags;
+		pd->offset = *offset_data;
+		if (!flags) {
+			pd->flags      = 0;
+			pd->size       = info->page_size;
+			pd->page_flags = 0;
+			*offset_data  += pd->size;
+			if (!write_kdump_page(cd_header, cd_page, pd,
+					ext->buf + index * info->page_size))
+				return FALSE;
+			continue;
+		}
+
+		pd->size = size_out;
+		if (ext->nr > 1) {
+			pd->flags      = flags | DUMP_DH_EXTENT;
+			pd->page_flags = EXTENT_PAGE_FLAGS(ext->nr, index);
+		} else {
+			pd->flags      = flags;
+			pd->page_flags = 0;
+		}
+		if (index == 0) {
+			if (!write_kdump_page(cd_header, cd_page, pd,
+					      ext->buf_out))
+				return FALSE;
+		} else if (!write_cache(cd_header, pd, sizeof(page_desc_t)))
+			return FALSE;
+	}
+	if (flags)
+		*offset_data += size_out;
+
+	ext->nr = ext->nr_pd = 0;
+
+	/*
+	 * Write the frame before its buffers are reused.
+	 */
+	if (cd_page->nr_iov && !write_cache_bufsz(cd_page))
+		return FALSE;
+
+	return TRUE;
+}
+
+static int
+write_page_desc(struct cache_data *cd_header, struct extent *ext,
+		struct page_desc *pd)
+{
+	if (!ext->max)
+		return write_cache(cd_header, pd, sizeof(page_desc_t));
+
+	ext->pd[ext->nr_pd++] = *pd;
+	return TRUE;
+}
+
+int
+write_kdump_pages_parallel_cyclic(struct cache_data *cd_header,
+				  struct cache_data *cd_page,
+				  struct page_desc *pd_zero,
+				  off_t *offset_data, struct cycle *cycle)
+{
+	if (info->flag_elf_dumpfile)
+		return FALSE;
+
+	info->num_page_writer = 1;
+	set_page_writer(&info->page_writer[0], cd_header, cd_page, pd_zero,
+			offset_data, info->dedup_table, cycle->start_pfn,
+			cycle->end_pfn, cycle);
+
+	return write_kdump_pages_parallel(cycle);
+}
+
 int
 write_kdump_pages_cyclic(struct cache_data *cd_header, struct cache_data *cd_page,
 			 struct page_desc *pd_zero, off_t *offset_data, struct cycle *cycle)
@@ -8852,10 +12048,14 @@ write_kdump_pages_cyclic(struct cache_data *cd_header, struct cache_data *cd_pag
 	mdf_pfn_t pfn, per;
 	mdf_pfn_t start_pfn, end_pfn;
 	unsigned long size_out;
+	unsigned long long fill, hash = 0, check = 0, t = 0;
+	struct dedup_entry *entry;
 	struct page_desc pd;
-	unsigned char *buf = NULL, *buf_out = NULL;
-	unsigned long len_buf_out;
+	unsigned char *buf, *buf_out = NULL, *pool = NULL;
+	unsigned long len_buf_out, slot_size;
+	int slot = 0, incompressible;
 	struct timespec ts_start;
+	struct extent ext;
 	int ret = FALSE;
 	z_stream z_stream, *stream = NULL;
 #ifdef USELZO
@@ -8868,8 +12068,12 @@ write_kdump_pages_cyclic(struct cache_data *cd_header, struct cache_data *cd_pag
 	if (info->flag_elf_dumpfile)
 		return FALSE;
 
+	memset(&ext, 0, sizeof(ext));
+
 	if (info->flag_compress & DUMP_DH_COMPRESSED_ZLIB) {
-		if (!initialize_zlib(&z_stream, Z_BEST_SPEED)) {
+		if (!initialize_zlib(&z_stream, info->compress_adapt.strong
+					      ? ZLIB_LEVEL_STRONG
+					      : COMPRESS_LEVEL_FAST)) {
 			ERRMSG("Can't initialize the zlib stream.\n");
 			goto out;
 		}
@@ -8894,16 +12098,46 @@ write_kdump_pages_cyclic(struct cache_data *cd_header, struct cache_data *cd_pag
 
 	len_buf_out = calculate_len_buf_out(info->page_size);
 
-	if ((buf_out = malloc(len_buf_out)) == NULL) {
-		ERRMSG("Can't allocate memory for the compression buffer. %s\n",
+	/*
+	 * The page data is written from the slots of pool without
+	 * copying, so a slot is not reused while cd_page refers to it.
+	 * cd_page refers to CACHE_IOV_NUM - 1 pages at most, and each
+	 * page takes two slots at most: one for reading and one for
+	 * compressing.
+	 */
+	slot_size = MAX(len_buf_out, info->page_size);
+	if ((pool = malloc(slot_size * PAGE_POOL_NUM)) == NULL) {
+		ERRMSG("Can't allocate memory for the page buffer. %s\n",
 		       strerror(errno));
 		goto out;
 	}
 
-	buf = malloc(info->page_size);
-	if (!buf) {
-		ERRMSG("Can't allocate memory. %s\n", strerror(errno));
-		goto out;
+	/*
+	 * With --extent-size, the dumpable pages are read into ext.buf
+	 * and compressed as a frame when it gets full. The descriptors
+	 * of the zero pages and the filled pages between them are held
+	 * in ext.pd to be written in order.
+	 */
+	if (EXTENT_PAGES() > 1) {
+		ext.max = EXTENT_PAGES();
+		ext.max_pd = ext.max * 2;
+		ext.len_buf_out = calculate_len_buf_out(ext.max
+							* info->page_size);
+		ext.pd = malloc(sizeof(struct page_desc) * ext.max_pd);
+		ext.buf = malloc(ext.max * info->page_size);
+		ext.buf_out = malloc(ext.len_buf_out);
+		if (!ext.pd || !ext.buf || !ext.buf_out) {
+			ERRMSG("Can't allocate memory for the frame buffer. %s\n",
+			       strerror(errno));
+			goto out;
+		}
+		ext.stream = stream;
+#ifdef USELZO
+		ext.wrkmem = wrkmem;
+#endif
+#ifdef USEZSTD
+		ext.cctx = cctx;
+#endif
 	}
 
 	per = info->num_dumpable / 10000;
@@ -8924,15 +12158,28 @@ write_kdump_pages_cyclic(struct cache_data *cd_header, struct cache_data *cd_pag
 	for (pfn = start_pfn; pfn < end_pfn; pfn++) {
 
 		/*
-		 * Check the excluded page.
+		 * Skip the excluded pages.
 		 */
-		if (!is_dumpable(info->bitmap2, pfn, cycle))
-			continue;
+		pfn = find_next_set(info->bitmap2, pfn, end_pfn, cycle);
+		if (pfn >= end_pfn)
+			break;
 
 		if ((num_dumped % per) == 0)
 			print_progress(PROGRESS_COPY, num_dumped, info->num_dumpable, &ts_start);
 		num_dumped++;
 
+		if (ext.max) {
+			if ((ext.nr == ext.max || ext.nr_pd == ext.max_pd)
+			    && !write_extent(cd_header, cd_page, &ext,
+					     offset_data))
+				goto out;
+			buf = ext.buf + ext.nr * info->page_size;
+		} else {
+			buf = pool + slot * slot_size;
+			buf_out = pool + ((slot + 1) % PAGE_POOL_NUM)
+				* slot_size;
+		}
+
 		if (!read_pfn(pfn, buf))
 			goto out;
 
@@ -8943,16 +12190,63 @@ write_kdump_pages_cyclic(struct cache_data *cd_header, struct cache_data *cd_pag
 		 */
 		if ((info->dump_level & DL_EXCLUDE_ZERO)
 		    && is_zero_page(buf, info->page_size)) {
-			if (!write_cache(cd_header, pd_zero, sizeof(page_desc_t)))
+			if (!write_page_desc(cd_header, &ext, pd_zero))
 				goto out;
 			pfn_zero++;
 			continue;
 		}
 		/*
-		 * Compress the page data.
+		 * Write only the page header of the page filled with
+		 * one value.
+		 */
+		if (info->flag_same_filled
+		    && is_filled_page(buf, info->page_size, &fill)) {
+			pd.flags      = DUMP_DH_FILLED_PAGE;
+			pd.size       = 0;
+			pd.page_flags = 0;
+			pd.offset     = fill;
+			if (!write_page_desc(cd_header, &ext, &pd))
+				goto out;
+			continue;
+		}
+		/*
+		 * Share the data of the identical page written before.
+		 */
+		if (info->flag_dedup) {
+			hash_page(buf, info->page_size, &hash, &check);
+			if ((entry = lookup_dedup_entry(info->dedup_table,
+							hash, check)) != NULL
+			    && is_same_page(entry->pfn, buf, buf_out)) {
+				set_dedup_page_desc(&pd, entry);
+				if (!write_cache(cd_header, &pd, sizeof(page_desc_t)))
+					goto out;
+				continue;
+			}
+		}
+		/*
+		 * Add the page to the frame, whose data is written later.
+		 */
+		if (ext.max) {
+			pd.flags      = DUMP_DH_EXTENT;
+			pd.size       = 0;
+			pd.page_flags = ext.nr++;
+			pd.offset     = 0;
+			ext.pd[ext.nr_pd++] = pd;
+			continue;
+		}
+		/*
+		 * Compress the page data. With --compress-budget, the page
+		 * which looks incompressible is stored as it is.
 		 */
 		size_out = len_buf_out;
-		if ((info->flag_compress & DUMP_DH_COMPRESSED_ZLIB)
+		incompressible = info->compress_budget
+		    && is_incompressible_page(buf, info->page_size);
+		if (info->compress_budget)
+			t = get_time_nsec();
+		if (incompressible) {
+			pd.flags = 0;
+			pd.size  = info->page_size;
+		} else if ((info->flag_compress & DUMP_DH_COMPRESSED_ZLIB)
 		    && ((size_out = len_buf_out),
 			compress_mdf(stream, buf_out, &size_out,
 				buf, info->page_size, Z_BEST_SPEED) == Z_OK)
@@ -8982,18 +12276,31 @@ write_kdump_pages_cyclic(struct cache_data *cd_header, struct cache_data *cd_pag
 #endif
 #ifdef USEZSTD
 		} else if ((info->flag_compress & DUMP_DH_COMPRESSED_ZSTD)
-			    && (size_out = ZSTD_compressCCtx(cctx,
+			    && (size_out = compress_zstd(cctx,
 						buf_out, len_buf_out,
-						buf, info->page_size, 1))
+						buf, info->page_size,
+						&info->compress_adapt))
 			    && (!ZSTD_isError(size_out))
 			    && (size_out < info->page_size)) {
 			pd.flags = DUMP_DH_COMPRESSED_ZSTD;
 			pd.size  = size_out;
+#endif
+#ifdef USELZ4
+		} else if ((info->flag_compress & DUMP_DH_COMPRESSED_LZ4)
+			    && (size_out = LZ4_compress_default((char *)buf,
+						(char *)buf_out,
+						info->page_size, len_buf_out))
+			    && (size_out < info->page_size)) {
+			pd.flags = DUMP_DH_COMPRESSED_LZ4;
+			pd.size  = size_out;
 #endif
 		} else {
 			pd.flags = 0;
 			pd.size  = info->page_size;
 		}
+		if (info->compress_budget && !incompressible)
+			account_compress(&info->compress_adapt, stream, t, 1,
+					 info->page_size, pd.size);
 		pd.page_flags = 0;
 		pd.offset     = *offset_data;
 		*offset_data  += pd.size;
@@ -9003,15 +12310,31 @@ write_kdump_pages_cyclic(struct cache_data *cd_header, struct cache_data *cd_pag
                 */
                if (!write_kdump_page(cd_header, cd_page, &pd, pd.flags ? buf_out : buf))
                        goto out;
+		if (info->flag_dedup)
+			add_dedup_entry(info->dedup_table, hash, check, pfn, &pd);
+		slot = (slot + (pd.flags ? 2 : 1)) % PAGE_POOL_NUM;
         }
 
+	if (ext.nr_pd && !write_extent(cd_header, cd_page, &ext, offset_data))
+		goto out;
+
+	/*
+	 * Write the pages in pool before it is freed.
+	 */
+	if (!write_cache_bufsz(cd_page))
+		goto out;
+
 	ret = TRUE;
 out:
-	if (buf != NULL)
-		free(buf);
-
-	if (buf_out != NULL)
-		free(buf_out);
+	if (cd_page->nr_iov) {
+		cd_page->buf_size = 0;
+		cd_page->nr_iov = 0;
+	}
+	free(ext.pd);
+	free(ext.buf);
+	free(ext.buf_out);
+	if (pool != NULL)
+		free(pool);
 #ifdef USEZSTD
 	if (cctx != NULL)
 		ZSTD_freeCCtx(cctx);
@@ -9079,7 +12402,8 @@ update_eraseinfo_of_sub_header(off_t offset_eraseinfo,
 	info->sub_header.size_eraseinfo   = size_eraseinfo;
 
 	if (!write_buffer(info->fd_dumpfile, offset, &info->sub_header,
-			sizeof(struct kdump_sub_header), info->name_dumpfile))
+			get_kdump_sub_header_size(&info->sub_header),
+			info->name_dumpfile))
 		return FALSE;
 
 	return TRUE;
@@ -9379,46 +12703,64 @@ write_kdump_bitmap2(struct cycle *cycle) {
 	}
 }
 
-int
-write_kdump_pages_and_bitmap_cyclic(struct cache_data *cd_header, struct cache_data *cd_page)
+/*
+ * Set the offsets of the page descriptors and the page data of the
+ * kdump-compressed dumpfile, and write the data of zero-filled page.
+ */
+static int
+prepare_kdump_pages(struct cache_data *cd_header, struct cache_data *cd_page,
+		    struct page_desc *pd_zero, off_t *offset_data)
 {
-	struct page_desc pd_zero;
-	off_t offset_data=0;
 	struct disk_dump_header *dh = info->dump_header;
-	struct timespec ts_start;
 
 	cd_header->offset
 		= (DISKDUMP_HEADER_BLOCKS + dh->sub_hdr_size + dh->bitmap_blocks)
 		* dh->block_size;
 	cd_page->offset = cd_header->offset + sizeof(page_desc_t)*info->num_dumpable;
-	offset_data = cd_page->offset;
-	
+	*offset_data = cd_page->offset;
+
 	/*
 	 * Write the data of zero-filled page.
 	 */
 	if (info->dump_level & DL_EXCLUDE_ZERO) {
 		unsigned char *buf;
 
-		pd_zero.size = info->page_size;
-		pd_zero.flags = 0;
-		pd_zero.offset = offset_data;
-		pd_zero.page_flags = 0;
+		pd_zero->size = info->page_size;
+		pd_zero->flags = 0;
+		pd_zero->offset = *offset_data;
+		pd_zero->page_flags = 0;
 
 		buf = malloc(info->page_size);
 		if (!buf) {
 			ERRMSG("Can't allocate memory. %s\n", strerror(errno));
 			return FALSE;
 		}
-		memset(buf, 0, pd_zero.size);
+		memset(buf, 0, pd_zero->size);
 
-		if (!write_cache(cd_page, buf, pd_zero.size)) {
+		if (!write_cache(cd_page, buf, pd_zero->size)) {
 			free(buf);
 			return FALSE;
 		}
 		free(buf);
-		offset_data += pd_zero.size;
+		*offset_data += pd_zero->size;
 	}
 
+	return TRUE;
+}
+
+int
+write_kdump_pages_and_bitmap_cyclic(struct cache_data *cd_header, struct cache_data *cd_page)
+{
+	struct page_desc pd_zero;
+	off_t offset_data=0;
+	struct timespec ts_start;
+
+	if (!prepare_dedup_table(&info->dedup_table))
+		return FALSE;
+
+	if (!prepare_kdump_pages(cd_header, cd_page, &pd_zero, &offset_data))
+		return FALSE;
+
 	if (info->flag_cyclic) {
 		/*
 		 * Reset counter for debug message.
@@ -9523,6 +12865,10 @@ close_dump_file(void)
 	if (info->flag_flatten || info->flag_dry_run)
 		return;
 
+	if (info->fd_dumpfile_direct >= 0)
+		close(info->fd_dumpfile_direct);
+	info->fd_dumpfile_direct = -1;
+
 	if (close(info->fd_dumpfile) < 0)
 		ERRMSG("Can't close the dump file(%s). %s\n",
 		    info->name_dumpfile, strerror(errno));
@@ -10363,6 +13709,36 @@ print_vtop(void)
 	return;
 }
 
+static void
+print_stage_stat(void)
+{
+	static const char *stage_name[NR_STAGES] = {
+		[STAGE_READ]		= "Read",
+		[STAGE_FILTER]		= "Filter",
+		[STAGE_COMPRESS]	= "Compress",
+		[STAGE_WRITE]		= "Write",
+	};
+	struct stage_stat *stat;
+	int i;
+
+	/*
+	 * The time of the producer stages is summed over the threads.
+	 */
+	REPORT_MSG("Pipeline stage   bytes             seconds         MB/s\n");
+	for (i = 0; i < NR_STAGES; i++) {
+		stat = &info->stage_stat[i];
+		REPORT_MSG("  %-9s : %-16llu  %6llu.%06llu",
+		    stage_name[i], stat->bytes,
+		    stat->nsec / 1000000000ULL,
+		    (stat->nsec % 1000000000ULL) / 1000);
+		if (stat->nsec)
+			REPORT_MSG("  %8.1f",
+			    stat->bytes * 1000.0 / stat->nsec);
+		REPORT_MSG("\n");
+	}
+	REPORT_MSG("\n");
+}
+
 void
 print_report(void)
 {
@@ -10415,7 +13791,16 @@ print_report(void)
 	if (cache_hit + cache_miss)
 		REPORT_MSG(", hit rate: %.1f%%",
 		    100.0 * cache_hit / (cache_hit + cache_miss));
+	REPORT_MSG("\n");
+	REPORT_MSG("VTOP cache hit: %lld, miss: %lld",
+		   vtop_cache_hit, vtop_cache_miss);
+	if (vtop_cache_hit + vtop_cache_miss)
+		REPORT_MSG(", hit rate: %.1f%%",
+		    100.0 * vtop_cache_hit / (vtop_cache_hit + vtop_cache_miss));
 	REPORT_MSG("\n\n");
+
+	if (info->num_threads)
+		print_stage_stat();
 }
 
 static void
@@ -10597,6 +13982,195 @@ reopen_dump_memory()
 	return TRUE;
 }
 
+static void
+load_split_dumpfile(struct split_dumpfile *sd, int i)
+{
+	info->name_dumpfile      = SPLITTING_DUMPFILE(i);
+	info->split_start_pfn    = SPLITTING_START_PFN(i);
+	info->split_end_pfn      = SPLITTING_END_PFN(i);
+	info->fd_dumpfile        = sd->fd_dumpfile;
+	info->fd_dumpfile_direct = sd->fd_dumpfile_direct;
+	info->align_dumpfile_direct = sd->align_dumpfile_direct;
+	info->offset_bitmap1     = sd->offset_bitmap1;
+	info->sub_header         = sd->sub_header;
+}
+
+static void
+save_split_dumpfile(struct split_dumpfile *sd)
+{
+	sd->fd_dumpfile        = info->fd_dumpfile;
+	sd->fd_dumpfile_direct = info->fd_dumpfile_direct;
+	sd->align_dumpfile_direct = info->align_dumpfile_direct;
+	sd->offset_bitmap1     = info->offset_bitmap1;
+	sd->sub_header         = info->sub_header;
+}
+
+/*
+ * Write all the dumpfiles of --split at the same time in this process
+ * with --num-threads. The bitmaps of each cycle are created once and
+ * written to every dumpfile, and the producer threads read and compress
+ * the pages for the page writers of all the dumpfiles. The state of
+ * info for a dumpfile, such as its fd, is switched with
+ * load_split_dumpfile() and save_split_dumpfile().
+ */
+static int
+writeout_split_dumpfiles_parallel(void)
+{
+	struct split_dumpfile *sd;
+	struct timespec ts_start;
+	struct cycle cycle = {0};
+	int i;
+	int ret = FALSE;
+
+	if ((sd = calloc(info->num_dumpfile, sizeof(*sd))) == NULL) {
+		ERRMSG("Can't allocate memory for the dumpfiles. %s\n",
+		       strerror(errno));
+		return FALSE;
+	}
+	for (i = 0; i < info->num_dumpfile; i++) {
+		sd[i].fd_dumpfile = -1;
+		sd[i].fd_dumpfile_direct = -1;
+	}
+
+	info->flag_nospace = FALSE;
+
+	if (!prepare_split_erase_info(info->num_dumpfile))
+		goto out;
+
+	for (i = 0; i < info->num_dumpfile; i++) {
+		load_split_dumpfile(&sd[i], i);
+		if (!open_dump_file())
+			goto out;
+		save_split_dumpfile(&sd[i]);
+
+		if (!prepare_cache_data(&sd[i].cd_header))
+			goto out;
+		if (!prepare_cache_data(&sd[i].cd_page))
+			goto out;
+		if (!write_kdump_header())
+			goto out;
+		if (!prepare_dedup_table(&sd[i].dedup_table))
+			goto out;
+		if (!prepare_kdump_pages(&sd[i].cd_header, &sd[i].cd_page,
+					 &sd[i].pd_zero, &sd[i].offset_data))
+			goto out;
+		save_split_dumpfile(&sd[i]);
+	}
+
+	if (info->flag_cyclic) {
+		/*
+		 * Reset counter for debug message.
+		 */
+		pfn_zero = pfn_cache = pfn_cache_private = 0;
+		pfn_user = pfn_free = pfn_hwpoison = pfn_offline = 0;
+		pfn_memhole = info->max_mapnr;
+
+		if (!prepare_bitmap1_buffer())
+			goto out;
+	}
+
+	for_each_cycle(0, info->max_mapnr, &cycle)
+	{
+		if (info->flag_cyclic) {
+			if (!create_1st_bitmap(&cycle))
+				goto out;
+		}
+		for (i = 0; i < info->num_dumpfile; i++) {
+			load_split_dumpfile(&sd[i], i);
+			if (!write_kdump_bitmap1(&cycle))
+				goto out;
+			save_split_dumpfile(&sd[i]);
+		}
+	}
+
+	free_bitmap1_buffer();
+	if (info->flag_cyclic) {
+		if (!prepare_bitmap2_buffer())
+			goto out;
+	}
+
+	memset(&cycle, 0, sizeof(struct cycle));
+	for_each_cycle(0, info->max_mapnr, &cycle)
+	{
+		if (info->flag_cyclic) {
+			if (!create_2nd_bitmap(&cycle))
+				goto out;
+		}
+		for (i = 0; i < info->num_dumpfile; i++) {
+			load_split_dumpfile(&sd[i], i);
+			if (!write_kdump_bitmap2(&cycle))
+				goto out;
+			save_split_dumpfile(&sd[i]);
+
+			set_page_writer(&info->page_writer[i], &sd[i].cd_header,
+					&sd[i].cd_page, &sd[i].pd_zero,
+					&sd[i].offset_data, sd[i].dedup_table,
+					SPLITTING_START_PFN(i),
+					SPLITTING_END_PFN(i), &cycle);
+		}
+		info->num_page_writer = info->num_dumpfile;
+
+		if (!write_kdump_pages_parallel(&cycle))
+			goto write_cache_enospc;
+	}
+	free_bitmap2_buffer();
+
+	clock_gettime(CLOCK_MONOTONIC, &ts_start);
+
+	/*
+	 * Write the remainder, and the erase information of the pages of
+	 * each dumpfile.
+	 */
+	for (i = 0; i < info->num_dumpfile; i++) {
+		load_split_dumpfile(&sd[i], i);
+		if (!write_cache_bufsz(&sd[i].cd_page))
+			goto write_cache_enospc;
+		if (!write_cache_bufsz(&sd[i].cd_header))
+			goto write_cache_enospc;
+		set_split_erase_info(i);
+		if (!write_kdump_eraseinfo(&sd[i].cd_page))
+			goto out;
+		save_split_dumpfile(&sd[i]);
+	}
+
+	/*
+	 * print [100 %]
+	 */
+	print_progress(PROGRESS_COPY, num_dumped, info->num_dumpable, &ts_start);
+	print_execution_time(PROGRESS_COPY, &ts_start);
+	PROGRESS_MSG("\n");
+
+	ret = TRUE;
+write_cache_enospc:
+	/*
+	 * Keep the page descriptors written so far, as writeout_dumpfile()
+	 * does, so that the headers can be fixed up for the pages.
+	 */
+	if ((ret == FALSE) && info->flag_nospace) {
+		for (i = 0; i < info->num_dumpfile; i++) {
+			load_split_dumpfile(&sd[i], i);
+			if (!write_cache_bufsz(&sd[i].cd_header))
+				ERRMSG("This dumpfile may lost some important data.\n");
+		}
+	}
+out:
+	for (i = 0; i < info->num_dumpfile; i++) {
+		free_cache_data(&sd[i].cd_header);
+		free_cache_data(&sd[i].cd_page);
+		free(sd[i].dedup_table);
+		if (sd[i].fd_dumpfile >= 0) {
+			load_split_dumpfile(&sd[i], i);
+			close_dump_file();
+		}
+	}
+	free(sd);
+
+	if ((ret == FALSE) && info->flag_nospace)
+		return NOSPACE;
+	else
+		return ret;
+}
+
 int
 get_next_dump_level(int index)
 {
@@ -10633,6 +14207,9 @@ writeout_multiple_dumpfiles(void)
 	if (!setup_splitting())
 		return FALSE;
 
+	if (info->num_threads)
+		return writeout_split_dumpfiles_parallel();
+
 	array_pid = malloc(sizeof(*array_pid) * info->num_dumpfile);
 	if (!array_pid) {
 		ERRMSG("Can't allocate memory for PID array. %s\n", strerror(errno));
@@ -10734,6 +14311,12 @@ retry:
 			&& !gather_filter_info())
 		return FALSE;
 
+	/*
+	 * Release the debuginfo sessions, which are not needed while
+	 * writing the pages.
+	 */
+	clean_dwarf_info();
+
 	if (!create_dump_bitmap())
 		return FALSE;
 
@@ -11063,6 +14646,10 @@ reassemble_kdump_header(void)
 	 */
 	if (!read_kdump_sub_header(&kh, SPLITTING_DUMPFILE(0)))
 		return FALSE;
+	if (dh.header_version < 7) {
+		kh.offset_zstd_dict = 0;
+		kh.size_zstd_dict = 0;
+	}
 
 	kh.split = 0;
 	kh.start_pfn = 0;
@@ -11075,7 +14662,8 @@ reassemble_kdump_header(void)
 		    info->name_dumpfile, strerror(errno));
 		return FALSE;
 	}
-	if (write(info->fd_dumpfile, &kh, sizeof(kh)) != sizeof(kh)) {
+	size = get_kdump_sub_header_size(&kh);
+	if (write(info->fd_dumpfile, &kh, size) != size) {
 		ERRMSG("Can't write a file(%s). %s\n",
 		    info->name_dumpfile, strerror(errno));
 		return FALSE;
@@ -11103,6 +14691,14 @@ reassemble_kdump_header(void)
 			goto out;
 		}
 	}
+	if (kh.size_zstd_dict) {
+		if (!copy_same_data(fd, info->fd_dumpfile, kh.offset_zstd_dict,
+				    kh.size_zstd_dict)) {
+			ERRMSG("Can't copy the zstd dictionary to %s.\n",
+			    info->name_dumpfile);
+			goto out;
+		}
+	}
 
 	/*
 	 * Write dump bitmap to both a dumpfile and a bitmap file.
@@ -11179,6 +14775,7 @@ reassemble_kdump_pages(void)
 	int i, fd = -1, ret = FALSE;
 	off_t offset_first_ph, offset_ph_org, offset_eraseinfo;
 	off_t offset_data_new, offset_zero_page = 0;
+	off_t offset_extent_org = 0, offset_extent_new = 0;
 	mdf_pfn_t pfn, start_pfn, end_pfn;
 	mdf_pfn_t num_dumpable;
 	unsigned long size_eraseinfo;
@@ -11250,9 +14847,11 @@ reassemble_kdump_pages(void)
 		end_pfn   = SPLITTING_END_PFN(i);
 
 		offset_ph_org = offset_first_ph;
+		offset_extent_org = 0;
 		for (pfn = start_pfn; pfn < end_pfn; pfn++) {
-			if (!is_dumpable(info->bitmap2, pfn, NULL))
-				continue;
+			pfn = find_next_set(info->bitmap2, pfn, end_pfn, NULL);
+			if (pfn >= end_pfn)
+				break;
 
 			num_dumped++;
 
@@ -11268,6 +14867,34 @@ reassemble_kdump_pages(void)
 				    SPLITTING_DUMPFILE(i), strerror(errno));
 				goto out;
 			}
+			if (pd.flags & DUMP_DH_FILLED_PAGE) {
+				/*
+				 * The page has no data.
+				 */
+				if (!write_cache(&cd_pd, &pd, sizeof(pd)))
+					goto out;
+				offset_ph_org += sizeof(pd);
+				continue;
+			}
+			if ((pd.flags & DUMP_DH_EXTENT)
+			    && (pd.offset == offset_extent_org)) {
+				/*
+				 * The frame of the page has been copied.
+				 */
+				pd.offset = offset_extent_new;
+				if (!write_cache(&cd_pd, &pd, sizeof(pd)))
+					goto out;
+				offset_ph_org += sizeof(pd);
+				continue;
+			}
+			if (pd.size > data_buf_size) {
+				data_buf_size = pd.size;
+				if ((data = realloc(data, data_buf_size)) == NULL) {
+					ERRMSG("Can't allocate memory for page"
+						" data.\n");
+					goto out;
+				}
+			}
 			if (lseek(fd, pd.offset, SEEK_SET) < 0) {
 				ERRMSG("Can't seek a file(%s). %s\n",
 				    SPLITTING_DUMPFILE(i), strerror(errno));
@@ -11289,12 +14916,24 @@ reassemble_kdump_pages(void)
 				offset_ph_org += sizeof(pd);
 				continue;
 			}
+			if (pd.flags & DUMP_DH_EXTENT) {
+				offset_extent_org = pd.offset;
+				offset_extent_new = offset_data_new;
+			}
 			pd.offset = offset_data_new;
 			if (!write_cache(&cd_pd, &pd, sizeof(pd)))
 				goto out;
 			offset_ph_org += sizeof(pd);
 
-			if (!write_cache(&cd_data, data, pd.size))
+			if (pd.size > info->page_size) {
+				/*
+				 * A frame may be bigger than the cache.
+				 */
+				if (!write_cache_bufsz(&cd_data)
+				    || !write_cache_iov(&cd_data, data, pd.size)
+				    || !write_cache_bufsz(&cd_data))
+					goto out;
+			} else if (!write_cache(&cd_data, data, pd.size))
 				goto out;
 
 			offset_data_new += pd.size;
@@ -11408,6 +15047,9 @@ check_param_for_generating_vmcoreinfo(int argc, char *argv[])
 
 		return FALSE;
 
+	if (info->name_debuginfo_cache && !info->name_vmlinux)
+		return FALSE;
+
 	if (info->flag_dry_run) {
 		MSG("--dry-run cannot be used with -g.\n");
 		return FALSE;
@@ -11501,17 +15143,76 @@ check_param_for_creating_dumpfile(int argc, char *argv[])
 	if (info->name_filterconfig && !info->name_vmlinux)
 		return FALSE;
 
+	if (info->name_debuginfo_cache && !info->name_vmlinux)
+		return FALSE;
+
 	if (info->flag_sadump_diskset && !sadump_is_supported_arch())
 		return FALSE;
 
 	if (info->num_threads) {
-		if (info->flag_split) {
-			MSG("--num-threads cannot used with --split.\n");
+		if (info->flag_elf_dumpfile) {
+			MSG("--num-threads cannot used with ELF format.\n");
 			return FALSE;
 		}
+	}
+
+	if (info->flag_same_filled && info->flag_elf_dumpfile) {
+		MSG("--same-filled-pages cannot used with ELF format.\n");
+		return FALSE;
+	}
 
+	if (info->flag_dedup && info->flag_elf_dumpfile) {
+		MSG("--dedup-pages cannot used with ELF format.\n");
+		return FALSE;
+	}
+
+	if (info->extent_size) {
 		if (info->flag_elf_dumpfile) {
-			MSG("--num-threads cannot used with ELF format.\n");
+			MSG("--extent-size cannot used with ELF format.\n");
+			return FALSE;
+		}
+		if (!info->flag_compress) {
+			MSG("--extent-size requires -c, -l, -p, -z or --lz4.\n");
+			return FALSE;
+		}
+		if (info->num_threads) {
+			MSG("--extent-size cannot used with --num-threads.\n");
+			return FALSE;
+		}
+		if (info->flag_dedup) {
+			MSG("--extent-size cannot used with --dedup-pages.\n");
+			return FALSE;
+		}
+		if (info->extent_size > EXTENT_SIZE_MAX) {
+			MSG("--extent-size must be %d or less.\n",
+			    EXTENT_SIZE_MAX);
+			return FALSE;
+		}
+	}
+
+	if (info->flag_zstd_dict) {
+		if (info->flag_elf_dumpfile) {
+			MSG("--zstd-dict cannot used with ELF format.\n");
+			return FALSE;
+		}
+		if (info->flag_compress != DUMP_DH_COMPRESSED_ZSTD) {
+			MSG("--zstd-dict requires -z.\n");
+			return FALSE;
+		}
+	}
+
+	if (info->compress_budget) {
+		if (info->flag_elf_dumpfile) {
+			MSG("--compress-budget cannot used with ELF format.\n");
+			return FALSE;
+		}
+		if (!(info->flag_compress
+		      & (DUMP_DH_COMPRESSED_ZLIB | DUMP_DH_COMPRESSED_ZSTD))) {
+			MSG("--compress-budget requires -c or -z.\n");
+			return FALSE;
+		}
+		if (info->flag_zstd_dict) {
+			MSG("--compress-budget cannot used with --zstd-dict.\n");
 			return FALSE;
 		}
 	}
@@ -11976,6 +15677,17 @@ static struct option longopts[] = {
 	{"check-params", no_argument, NULL, OPT_CHECK_PARAMS},
 	{"dry-run", no_argument, NULL, OPT_DRY_RUN},
 	{"show-stats", no_argument, NULL, OPT_SHOW_STATS},
+	{"io-uring", required_argument, NULL, OPT_IO_URING},
+	{"debuginfo-cache", required_argument, NULL, OPT_DEBUGINFO_CACHE},
+	{"cache-size", required_argument, NULL, OPT_CACHE_SIZE},
+	{"mem-map-batch", required_argument, NULL, OPT_MEM_MAP_BATCH},
+	{"same-filled-pages", no_argument, NULL, OPT_SAME_FILLED_PAGES},
+	{"dedup-pages", no_argument, NULL, OPT_DEDUP_PAGES},
+	{"extent-size", required_argument, NULL, OPT_EXTENT_SIZE},
+	{"zstd-dict", no_argument, NULL, OPT_ZSTD_DICT},
+	{"compress-budget", required_argument, NULL, OPT_COMPRESS_BUDGET},
+	{"lz4", no_argument, NULL, OPT_COMPRESS_LZ4},
+	{"direct-io", no_argument, NULL, OPT_DIRECT_IO},
 	{0, 0, 0, 0}
 };
 
@@ -12001,6 +15713,7 @@ main(int argc, char *argv[])
 	info->fd_xen_syms = -1;
 	info->fd_memory = -1;
 	info->fd_dumpfile = -1;
+	info->fd_dumpfile_direct = -1;
 	info->fd_bitmap = -1;
 	info->kaslr_offset = 0;
 	initialize_tables();
@@ -12104,6 +15817,12 @@ main(int argc, char *argv[])
 		case OPT_COMPRESS_ZSTD:
 			info->flag_compress = DUMP_DH_COMPRESSED_ZSTD;
 			break;
+		case OPT_COMPRESS_LZ4:
+			info->flag_compress = DUMP_DH_COMPRESSED_LZ4;
+			break;
+		case OPT_DIRECT_IO:
+			info->flag_direct_io = TRUE;
+			break;
 		case OPT_XEN_PHYS_START:
 			info->xen_phys_start = strtoul(optarg, NULL, 0);
 			break;
@@ -12153,6 +15872,33 @@ main(int argc, char *argv[])
 		case OPT_NUM_THREADS:
 			info->num_threads = MAX(atoi(optarg), 0);
 			break;
+		case OPT_IO_URING:
+			info->io_uring_depth = MAX(atoi(optarg), 0);
+			break;
+		case OPT_DEBUGINFO_CACHE:
+			info->name_debuginfo_cache = optarg;
+			break;
+		case OPT_CACHE_SIZE:
+			info->cache_size = MAX(atoi(optarg), 0);
+			break;
+		case OPT_MEM_MAP_BATCH:
+			info->mem_map_batch = MAX(atoi(optarg), 0);
+			break;
+		case OPT_SAME_FILLED_PAGES:
+			info->flag_same_filled = TRUE;
+			break;
+		case OPT_DEDUP_PAGES:
+			info->flag_dedup = TRUE;
+			break;
+		case OPT_EXTENT_SIZE:
+			info->extent_size = MAX(atoi(optarg), 0);
+			break;
+		case OPT_ZSTD_DICT:
+			info->flag_zstd_dict = TRUE;
+			break;
+		case OPT_COMPRESS_BUDGET:
+			info->compress_budget = MAX(atoi(optarg), 0);
+			break;
 		case OPT_CHECK_PARAMS:
 			info->flag_check_params = TRUE;
 			message_level = DEFAULT_MSG_LEVEL;
@@ -12360,6 +16106,12 @@ out:
 			free(info->kh_memory);
 		if (info->valid_pages)
 			free(info->valid_pages);
+		free_page_desc_cache(&pd_cache);
+		free_mem_map_reader(&mm_reader);
+		free_cycle_bitmap();
+		free_zstd_dict();
+		if (info->dedup_table)
+			free(info->dedup_table);
 		if (info->bitmap_memory) {
 			if (info->bitmap_memory->buf)
 				free(info->bitmap_memory->buf);
@@ -12369,6 +16121,8 @@ out:
 			close(info->fd_memory);
 		if (info->fd_dumpfile >= 0)
 			close(info->fd_dumpfile);
+		if (info->fd_dumpfile_direct >= 0)
+			close(info->fd_dumpfile_direct);
 		if (info->fd_bitmap >= 0)
 			close(info->fd_bitmap);
 		if (vt.node_online_map != NULL)
@@ -32,6 +32,7 @@
 #include <byteswap.h>
 #include <getopt.h>
 #include <sys/mman.h>
+#include <sys/uio.h>
 #ifdef USELZO
 #include <lzo/lzo1x.h>
 #endif
@@ -40,6 +41,13 @@
 #endif
 #ifdef USEZSTD
 #include <zstd.h>
+#include <zdict.h>
+#endif
+#ifdef USELZ4
+#include <lz4.h>
+#endif
+#ifdef USEURING
+#include <liburing.h>
 #endif
 #include "common.h"
 #include "dwarf_info.h"
@@ -49,6 +57,11 @@
 #include <pthread.h>
 #include <semaphore.h>
 #include <inttypes.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 #define VMEMMAPSTART 0xffffea0000000000UL
 #define BITS_PER_WORD 64
@@ -230,6 +243,7 @@ isAnon(unsigned long mapping)
 
 #define BITPERBYTE		(8)
 #define PGMM_CACHED		(512)
+#define MEM_MAP_BATCH		(16384)	/* struct pages read at a time */
 #define PFN_EXCLUDED		(256)
 #define BUFSIZE			(1024)
 #define BUFSIZE_FGETS		(1500)
@@ -478,9 +492,14 @@ do { \
 #define FD_BITMAP_MEMORY_PARALLEL(i)	info->parallel_info[i].fd_bitmap_memory
 #define FD_BITMAP_PARALLEL(i)		info->parallel_info[i].fd_bitmap
 #define BUF_PARALLEL(i)			info->parallel_info[i].buf
-#define BUF_OUT_PARALLEL(i)		info->parallel_info[i].buf_out
 #define MMAP_CACHE_PARALLEL(i)		info->parallel_info[i].mmap_cache
+#define PAGE_DESC_CACHE_PARALLEL(i)	info->parallel_info[i].page_desc_cache
+#define MEM_MAP_READER_PARALLEL(i)	info->parallel_info[i].mem_map_reader
+#define PAGE_DATA_SLOTS_PARALLEL(i)	info->parallel_info[i].page_data_slots
+#define STAGE_STAT_PARALLEL(i)		info->parallel_info[i].stage_stat
+#define URING_IO_PARALLEL(i)		info->parallel_info[i].uring_io
 #define ZLIB_STREAM_PARALLEL(i)		info->parallel_info[i].zlib_stream
+#define COMPRESS_ADAPT_PARALLEL(i)	info->parallel_info[i].compress_adapt
 #ifdef USELZO
 #define WRKMEM_PARALLEL(i)		info->parallel_info[i].wrkmem
 #endif
@@ -1063,6 +1082,7 @@ int get_phys_base_x86_64(void);
 int get_machdep_info_x86_64(void);
 int get_versiondep_info_x86_64(void);
 unsigned long long vtop4_x86_64(unsigned long vaddr);
+unsigned long long vtop4_x86_64_size(unsigned long vaddr, unsigned long long *size);
 unsigned long long vtop4_x86_64_pagetable(unsigned long vaddr, unsigned long pagetable);
 #define find_vmemmap()		find_vmemmap_x86_64()
 #define get_phys_base()		get_phys_base_x86_64()
@@ -1070,6 +1090,7 @@ unsigned long long vtop4_x86_64_pagetable(unsigned long vaddr, unsigned long pag
 #define get_versiondep_info()	get_versiondep_info_x86_64()
 #define get_kaslr_offset(X)	get_kaslr_offset_x86_64(X)
 #define vaddr_to_paddr(X)	vtop4_x86_64(X)
+#define vaddr_to_paddr_size(X, S)	vtop4_x86_64_size(X, S)
 #define paddr_to_vaddr(X)	paddr_to_vaddr_general(X)
 #define is_phys_addr(X)		stub_true_ul(X)
 #define arch_crashkernel_mem_size()	stub_false()
@@ -1167,6 +1188,15 @@ unsigned long long vaddr_to_paddr_mips64(unsigned long vaddr);
 #define arch_crashkernel_mem_size()	stub_false()
 #endif		/* mips64 */
 
+/*
+ * vaddr_to_paddr_size() also stores the size of the page which maps the
+ * virtual address, so that a huge page can be cached as a whole. The
+ * architectures which don't report huge pages translate per page.
+ */
+#ifndef vaddr_to_paddr_size
+#define vaddr_to_paddr_size(X, S)	(*(S) = PAGESIZE(), vaddr_to_paddr(X))
+#endif
+
 typedef unsigned long long mdf_pfn_t;
 
 #ifndef ARCH_PFN_OFFSET
@@ -1228,13 +1258,60 @@ struct dump_bitmap {
 	off_t		offset;
 };
 
+#ifdef USEURING
+/*
+ * An asynchronous read or write on io_uring.
+ */
+struct uring_req {
+	void	*buf;
+	size_t	len;		/* 0 if not submitted */
+	off_t	offset;
+	int	res;		/* -EINPROGRESS while in flight */
+};
+
+struct uring_io {
+	struct io_uring	ring;
+	int		depth;		/* max requests in flight */
+	int		inflight;
+	int		fixed;		/* the buffers are registered */
+};
+
+/*
+ * The buffers of a cache_data flushed with io_uring. cache_data.buf
+ * is buf[cur], and the others may be being written.
+ */
+struct cache_uring {
+	struct uring_io		io;
+	int			nr_bufs;
+	int			cur;
+	char			**buf;
+	struct uring_req	*req;
+};
+#endif
+
+/*
+ * The max number of the buffers which write_cache_iov() gathers
+ * into one pwritev().
+ */
+#define CACHE_IOV_NUM	(64)
+#define PAGE_POOL_NUM	(CACHE_IOV_NUM * 2)	/* page buffers of serial path */
+
 struct cache_data {
 	int	fd;
 	char	*file_name;
 	char	*buf;
-	size_t	buf_size;
+	size_t	buf_size;	/* including the data of iov */
 	size_t	cache_size;
 	off_t	offset;
+	struct iovec	*iov;	/* the data written without copying */
+	int		nr_iov;
+	int		fd_direct;	/* fd opened with O_DIRECT, or -1 */
+	size_t		align_direct;	/* alignment of the O_DIRECT I/O */
+	char		*buf_direct;	/* the aligned buffer buf is in */
+	char		*block_direct;	/* a block read for the head */
+#ifdef USEURING
+	struct cache_uring	*uring;
+#endif
 };
 typedef unsigned long int ulong;
 typedef unsigned long long int ulonglong;
@@ -1243,11 +1320,13 @@ typedef unsigned long long int ulonglong;
  * for parallel process
  */
 
-#define PAGE_FLAG_NUM	(20)
-#define PAGE_DATA_NUM	(5)
+#define PFN_PER_BATCH	(64)	/* pfns claimed by a thread at a time */
+#define PAGE_DATA_NUM	(PFN_PER_BATCH)	/* page_data_buf per thread */
+#define PAGE_BATCH_NUM	(2)	/* page_batch per thread */
 #define WAIT_TIME	(60 * 10)
 #define PTHREAD_FAIL	((void *)-2)
-#define THREAD_REGION	(200 * 1024)
+#define THREAD_REGION	(200 * 1024 + PAGE_DATA_NUM * 2 * info->page_size \
+			 + PFN_PER_BATCH * 2 * info->page_size)
 
 struct mmap_cache {
 	char	*mmap_buf;
@@ -1255,17 +1334,204 @@ struct mmap_cache {
 	off_t   mmap_end_offset;
 };
 
+/*
+ * The last virtual-to-physical translation of a thread, which covers
+ * the whole page (or huge page) mapping [vaddr, vaddr + size).
+ */
+struct vtop_range {
+	unsigned long long	vaddr;
+	unsigned long long	paddr;
+	unsigned long long	size;
+};
+
+/*
+ * Reader of the struct pages of mem_map. A batch of struct pages is
+ * translated once per mapping of vmemmap and used in place in the mmap
+ * window if possible, or read into buf of mem_map_batch struct pages.
+ * If direct is FALSE, the batch is read by readmem() instead.
+ */
+struct mem_map_reader {
+	int			direct;
+	int			fd_memory;
+	pthread_mutex_t		*vtop_mutex;	/* NULL if not shared */
+	struct vtop_range	vtop_range;
+	struct mmap_cache	mmap_cache;
+	unsigned char		*buf;
+};
+
+/*
+ * Buffers for reading pages of a kdump-compressed VMCORE: a window of
+ * page descriptors starting at the position start, and a buffer for
+ * the compressed data of up to PAGE_READ_NUM pages.
+ */
+#define PAGE_DESC_CACHE_NUM	(256)
+#define PAGE_READ_NUM		(32)
+struct page_desc_cache {
+	page_desc_t		*pd;
+	unsigned long		start;
+	unsigned long		num;
+	char			*buf;
+
+	/*
+	 * the last frame of pages decompressed, and its compressed data
+	 */
+	off_t			extent_offset;
+	unsigned long		extent_nr;	/* 0 if none */
+	unsigned long		extent_len;
+	char			*extent;
+	unsigned long		extent_clen;
+	char			*extent_cbuf;
+#ifdef USEZSTD
+	ZSTD_DCtx		*zstd_dctx;	/* for info->zstd_ddict */
+#endif
+};
+
+/*
+ * Stages of the parallel pipeline. A producer reads a run of
+ * contiguous dumpable pages at once, filters the run, and compresses
+ * its pages one by one; a page writer writes them.
+ */
 enum {
-	FLAG_UNUSED,
-	FLAG_READY,
-	FLAG_FILLING
+	STAGE_READ,
+	STAGE_FILTER,
+	STAGE_COMPRESS,
+	STAGE_WRITE,
+	NR_STAGES,
 };
+
+struct stage_stat {
+	unsigned long long	nsec;	/* time spent in the stage */
+	unsigned long long	bytes;	/* bytes passed through the stage */
+};
+
+/*
+ * The compression level of the serial writer or of a producer thread
+ * with --compress-budget. The throughput and the ratio are measured
+ * over every COMPRESS_ADAPT_PAGES pages compressed. At the fast level,
+ * the strong level is chosen if the pages were compressed to
+ * COMPRESS_RATIO_STRONG percent or less, COMPRESS_COST_STRONG times
+ * faster than the budget. At the strong level, the fast level is chosen
+ * again if either is not met, and kept for COMPRESS_ADAPT_HOLD periods
+ * if the budget is not met.
+ */
+#define COMPRESS_LEVEL_FAST	(1)
+#define ZLIB_LEVEL_STRONG	(6)
+#define ZSTD_LEVEL_STRONG	(6)
+#define COMPRESS_ADAPT_PAGES	(4096)
+#define COMPRESS_ADAPT_HOLD	(8)
+#define COMPRESS_COST_STRONG	(4)
+#define COMPRESS_RATIO_STRONG	(75)	/* percent */
+
+struct compress_adapt {
+	int			strong;
+	int			hold;
+	unsigned long		nr_pages;
+	unsigned long long	nsec;
+	unsigned long long	size_in;
+	unsigned long long	size_out;
+};
+
+/*
+ * A run of contiguous dumpable pfns in a batch, read at once.
+ */
+struct pfn_run {
+	mdf_pfn_t		pfn;
+	mdf_pfn_t		nr;
+	unsigned char		*buf;
+#ifdef USEURING
+	struct uring_req	req;
+#endif
+};
+
+struct read_batch {
+	struct page_writer	*writer;	/* which writes the batch */
+	mdf_pfn_t		seq;		/* sequence number for writer */
+	mdf_pfn_t		pfn;		/* first pfn of the batch */
+	mdf_pfn_t		end_pfn;
+	int			nr_runs;
+	struct pfn_run		run[PFN_PER_BATCH / 2];
+};
+
+/*
+ * The table of the pages written with --dedup-pages, so that a page
+ * identical to one of them shares its data. It has DEDUP_TABLE_NUM
+ * entries, and a page is looked up in the DEDUP_WAYS entries of its
+ * hash value. A page matching the hashes shares the data only if it is
+ * identical to the page of pfn, which is read again to compare them.
+ * An entry is never replaced, so the producer threads can look it up
+ * while the page writer adds new entries. Each DUMPFILE of --split has
+ * its own table.
+ */
+#define DEDUP_TABLE_NUM	(1 << 16)
+#define DEDUP_WAYS	(4)
+
+struct dedup_entry {
+	unsigned long long	hash;		/* 0 if unused */
+	unsigned long long	check;		/* another hash of the page */
+	mdf_pfn_t		pfn;		/* the page written */
+	off_t			offset;
+	unsigned int		size;
+	unsigned int		flags;
+};
+
+/*
+ * With --zstd-dict, up to ZSTD_DICT_SAMPLES dumpable pages spread over
+ * the memory are sampled to train a dictionary of ZSTD_DICT_SIZE bytes.
+ */
+#define ZSTD_DICT_SIZE		(64 * 1024)
+#define ZSTD_DICT_SAMPLES	(2048)
+
+/*
+ * Dumpable pages to be compressed as one frame with --extent-size.
+ */
+#define EXTENT_SIZE_MAX	(1024)		/* kilo bytes */
+
+/*
+ * Pages of a frame. Frames are used only if they hold two pages or more.
+ */
+#define EXTENT_PAGES()	(info->extent_size * 1024 / info->page_size)
+
+struct extent {
+	int		nr;		/* pages in buf */
+	int		max;		/* pages of a frame */
+	int		nr_pd;		/* page descriptors in pd */
+	int		max_pd;
+	struct page_desc *pd;
+	unsigned char	*buf;
+	unsigned char	*buf_out;
+	unsigned long	len_buf_out;
+	z_stream	*stream;
+#ifdef USELZO
+	lzo_bytep	wrkmem;
+#endif
+#ifdef USEZSTD
+	ZSTD_CCtx	*cctx;
+#endif
+};
+
 struct page_flag {
 	mdf_pfn_t pfn;
 	char zero;
-	char ready;
-	short index;
-	struct page_flag *next;
+	char filled;
+	int index;			/* up to PAGE_DATA_NUM * num_threads */
+	unsigned long long fill;	/* the value of the filled page */
+	unsigned long long hash;	/* the hashes for --dedup-pages */
+	unsigned long long check;
+	struct dedup_entry *dup;	/* the identical page written */
+};
+
+/*
+ * Reorder buffer entry for a batch of PFN_PER_BATCH pfns.
+ * The producer which claimed the batch appends the dumpable pages to
+ * page[] in pfn order, and posts ready once for each page and once more
+ * when the batch is finished. The page writer waits on ready, so it
+ * writes each page with O(1) work and sleeps while nothing is ready.
+ */
+struct page_batch {
+	mdf_pfn_t	seq;		/* sequence number of the batch */
+	int		nr_pages;	/* number of pages filled */
+	sem_t		ready;
+	struct page_flag page[PFN_PER_BATCH];
 };
 
 struct page_data
@@ -1273,7 +1539,66 @@ struct page_data
 	long size;
 	unsigned char *buf;
 	int flags;
-	int used;
+};
+
+/*
+ * Free slots of page_data_buf owned by one producer thread, as bits of
+ * mask. The producer clears the bit of a slot it takes, and the
+ * consumers set it when they give the slot back, so it is lock-free
+ * with any number of consumers. The producer sleeps on free while all
+ * of its slots are in use.
+ */
+struct page_data_slots {
+	unsigned long long	mask;	/* PAGE_DATA_NUM bits */
+	sem_t			free;	/* number of free slots */
+};
+
+/*
+ * A consumer of the parallel pipeline, which writes the dumpable pages
+ * of [start_pfn, end_pfn) to a dumpfile in pfn order. The producers
+ * fill its own entries of info->page_batch. There is one writer for
+ * each DUMPFILE of --split, and one otherwise.
+ */
+struct page_writer {
+	struct cache_data	*cd_header;
+	struct cache_data	*cd_page;
+	struct page_desc	*pd_zero;
+	off_t			*offset_data;
+	struct dedup_entry	*dedup_table;
+	mdf_pfn_t		start_pfn;
+	mdf_pfn_t		end_pfn;
+	mdf_pfn_t		nr_batches;
+	struct page_batch	*page_batch;	/* num_page_batch entries */
+	struct stage_stat	stage_stat;	/* of STAGE_WRITE */
+	struct timespec		*ts_start;
+	pthread_t		thread;
+	int			ret;
+
+	/*
+	 * the reader of the dump memory, to compare the pages of dedup
+	 * compressed at the same time by different producers
+	 */
+	int			fd_memory;
+	int			fd_bitmap_memory;
+	struct page_desc_cache	page_desc_cache;
+	struct mmap_cache	mmap_cache;
+};
+
+/*
+ * A DUMPFILE of --split written with --num-threads. All of them are
+ * written at the same time by the page writers of one process.
+ */
+struct split_dumpfile {
+	int			fd_dumpfile;
+	int			fd_dumpfile_direct;
+	size_t			align_dumpfile_direct;
+	off_t			offset_bitmap1;
+	struct kdump_sub_header	sub_header;
+	struct cache_data	cd_header;
+	struct cache_data	cd_page;
+	struct page_desc	pd_zero;
+	off_t			offset_data;
+	struct dedup_entry	*dedup_table;
 };
 
 struct thread_args {
@@ -1281,7 +1606,6 @@ struct thread_args {
 	unsigned long len_buf_out;
 	struct cycle *cycle;
 	struct page_data *page_data_buf;
-	struct page_flag *page_flag_buf;
 };
 
 /*
@@ -1310,6 +1634,35 @@ struct makedumpfile_data_header {
 	int64_t	buf_size;
 };
 
+/*
+ * debuginfo cache file
+ *   The tables of debugging information extracted from vmlinux, which
+ *   follow the header in the order of the size_* members.  The file is
+ *   only read by the same makedumpfile on the same machine, so the
+ *   variables are stored in host byte order.
+ */
+#define DEBUGINFO_CACHE_SIGNATURE	"makedumpfile-dic"
+#define SIG_LEN_DEBUGINFO_CACHE		(16)
+#define VERSION_DEBUGINFO_CACHE		(1)
+#define BUILD_ID_MAX			(64)
+
+struct debuginfo_cache_header {
+	char		signature[SIG_LEN_DEBUGINFO_CACHE];
+	char		mdf_version[32];	/* VERSION of makedumpfile */
+	int64_t		version;
+	int64_t		build_id_len;
+	unsigned char	build_id[BUILD_ID_MAX];	/* of vmlinux */
+	int64_t		size_symbol_table;
+	int64_t		size_size_table;
+	int64_t		size_offset_table;
+	int64_t		size_array_table;
+	int64_t		size_number_table;
+	int64_t		size_srcfile_table;
+	int32_t		flag_use_count;
+	int32_t		flag_use_printk_ringbuffer;
+	int32_t		flag_use_printk_log;
+};
+
 struct splitting_info {
 	char			*name_dumpfile;
 	int 			fd_bitmap;
@@ -1323,9 +1676,16 @@ struct parallel_info {
 	int			fd_memory;
 	int 			fd_bitmap_memory;
 	int			fd_bitmap;
-	unsigned char		*buf;
-	unsigned char 		*buf_out;
+	unsigned char		*buf;		/* PFN_PER_BATCH pages */
 	struct mmap_cache	*mmap_cache;
+	struct page_desc_cache	page_desc_cache;
+	struct mem_map_reader	mem_map_reader;
+	struct page_data_slots	page_data_slots;
+	struct stage_stat	stage_stat[NR_STAGES];
+#ifdef USEURING
+	struct uring_io		uring_io;
+#endif
+	struct compress_adapt	compress_adapt;
 	z_stream		zlib_stream;
 #ifdef USELZO
 	lzo_bytep		wrkmem;
@@ -1370,6 +1730,13 @@ struct DumpInfo {
 	int		flag_usemmap;	     /* /proc/vmcore supports mmap(2) */
 	int		flag_reassemble;     /* reassemble multiple dumpfiles into one */
 	int		flag_refiltering;    /* refilter from kdump-compressed file */
+	int		flag_vtop_cache;     /* cache virtual-to-physical translation */
+	int		flag_same_filled;    /* --same-filled-pages */
+	int		flag_dedup;          /* --dedup-pages */
+	unsigned long	extent_size;         /* --extent-size, kilo bytes */
+	int		flag_zstd_dict;      /* --zstd-dict */
+	unsigned long	compress_budget;     /* --compress-budget, MB/s */
+	int		flag_direct_io;      /* --direct-io */
 	int		flag_force;	     /* overwrite existing stuff */
 	int		flag_exclude_xen_dom;/* exclude Domain-U from xen-kdump */
 	int             flag_dmesg;          /* dump the dmesg log out of the vmcore file */
@@ -1464,6 +1831,7 @@ struct DumpInfo {
 
 	int			fd_vmlinux;
 	char			*name_vmlinux;
+	char			*name_debuginfo_cache;
 
 	int			fd_xen_syms;
 	char			*name_xen_syms;
@@ -1482,6 +1850,9 @@ struct DumpInfo {
 	 * Dump file info:
 	 */
 	int			fd_dumpfile;
+	int			fd_dumpfile_direct;
+	size_t			align_dumpfile_direct;	/* of the offset, size
+							   and buffer */
 	char			*name_dumpfile;
 	int			num_dumpfile;
 	struct splitting_info	*splitting_info;
@@ -1557,6 +1928,10 @@ struct DumpInfo {
 	mdf_pfn_t          num_dumpable;
 	unsigned long      bufsize_cyclic;
 	unsigned long      pfn_cyclic;
+	struct cycle_bitmap *cycle_bitmap;	     /* saved 2nd-bitmap of each cycle */
+	unsigned long      num_cycle_bitmap;
+	unsigned long long size_cycle_bitmap;
+	unsigned long long limit_cycle_bitmap;
 
 	/*
 	 * for mmap
@@ -1566,6 +1941,39 @@ struct DumpInfo {
 	off_t	mmap_end_offset;
 	off_t   mmap_region_size;
 
+	/*
+	 * for the page cache of readmem()
+	 */
+	unsigned long	cache_size;	/* kilo bytes, --cache-size */
+
+	/*
+	 * struct pages read at a time to exclude unnecessary pages
+	 */
+	unsigned long	mem_map_batch;	/* --mem-map-batch */
+
+	/*
+	 * the pages written with --dedup-pages
+	 */
+	struct dedup_entry *dedup_table;
+
+	/*
+	 * the compression level of the serial writer
+	 */
+	struct compress_adapt compress_adapt;
+
+	/*
+	 * the zstd dictionary trained from the pages sampled in the
+	 * bitmap pass with --zstd-dict, or read from the dumpfile
+	 */
+	char		*zstd_dict;
+	unsigned long	size_zstd_dict;
+	unsigned char	*zstd_samples;
+	unsigned long	num_zstd_samples;
+#ifdef USEZSTD
+	ZSTD_CDict	*zstd_cdict;
+	ZSTD_DDict	*zstd_ddict;
+#endif
+
 	/*
 	 * sadump info:
 	 */
@@ -1588,13 +1996,23 @@ struct DumpInfo {
 	pthread_t **threads;
 	struct thread_args *kdump_thread_args;
 	struct page_data *page_data_buf;
-	struct page_flag **page_flag_buf;
-	sem_t page_flag_buf_sem;
+	int num_page_batch;		/* page_batch of each page writer */
+	struct page_batch *page_batch;
+	int num_page_writer;
+	struct page_writer *page_writer;
+	sem_t page_writer_done;
+	pthread_mutex_t page_batch_mutex;
+	pthread_cond_t page_batch_cond;
 	pthread_rwlock_t usemmap_rwlock;
-	mdf_pfn_t current_pfn;
-	pthread_mutex_t current_pfn_mutex;
-	pthread_mutex_t page_data_mutex;
-	pthread_mutex_t filter_mutex;
+	pthread_mutex_t vtop_mutex;	/* page table walks of threads */
+	mdf_pfn_t current_batch;	/* next batch to be claimed */
+	mdf_pfn_t num_batches;		/* end of the batches to be claimed */
+	struct stage_stat stage_stat[NR_STAGES];	/* pipeline totals */
+
+	/*
+	 * queue depth of io_uring, 0 if not used
+	 */
+	int io_uring_depth;
 };
 extern struct DumpInfo		*info;
 
@@ -2312,6 +2730,32 @@ struct cycle {
 	mdf_pfn_t *exclude_pfn_counter;
 };
 
+/*
+ * The 2nd-bitmap of a cycle compressed at the first pass of the cyclic
+ * mode, and the numbers of the pages excluded while creating it, so that
+ * the later passes need not read mem_map again.
+ */
+struct cycle_bitmap {
+	unsigned char	*buf;
+	unsigned long	size;
+	mdf_pfn_t	pfn_zero;
+	mdf_pfn_t	pfn_cache;
+	mdf_pfn_t	pfn_cache_private;
+	mdf_pfn_t	pfn_user;
+	mdf_pfn_t	pfn_free;
+	mdf_pfn_t	pfn_hwpoison;
+	mdf_pfn_t	pfn_offline;
+
+	/* the multi-page region left by the previous cycle */
+	mdf_pfn_t	prev_exclude_pfn_start;
+	mdf_pfn_t	prev_exclude_pfn_end;
+
+	/* the multi-page region left to the next cycle */
+	mdf_pfn_t	exclude_pfn_start;
+	mdf_pfn_t	exclude_pfn_end;
+	mdf_pfn_t	*exclude_pfn_counter;
+};
+
 static inline int
 is_on(char *bitmap, mdf_pfn_t i)
 {
@@ -2374,19 +2818,117 @@ is_dumpable(struct dump_bitmap *bitmap, mdf_pfn_t pfn, struct cycle *cycle)
 	}
 }
 
+mdf_pfn_t find_next_set(struct dump_bitmap *bitmap, mdf_pfn_t pfn,
+			mdf_pfn_t end_pfn, struct cycle *cycle);
+mdf_pfn_t find_next_zero(struct dump_bitmap *bitmap, mdf_pfn_t pfn,
+			 mdf_pfn_t end_pfn, struct cycle *cycle);
+mdf_pfn_t count_dumpable(struct dump_bitmap *bitmap, mdf_pfn_t pfn,
+			 mdf_pfn_t end_pfn, struct cycle *cycle);
+mdf_pfn_t set_bitmap_range(struct dump_bitmap *bitmap, mdf_pfn_t pfn,
+			   mdf_pfn_t end_pfn, int val, struct cycle *cycle);
+
+/*
+ * Check whether the page is filled with one repeated 8-byte value, and
+ * return the value in val. 64 bytes are compared at a time with the
+ * vector instructions the compiler is allowed to use.
+ */
 static inline int
-is_zero_page(unsigned char *buf, long page_size)
+is_filled_page(unsigned char *buf, long page_size, unsigned long long *val)
 {
-	size_t i;
-	unsigned long long *vect = (unsigned long long *) buf;
-	long page_len = page_size / sizeof(unsigned long long);
+	unsigned long long v;
+	long i;
+#if defined(__AVX2__)
+	__m256i pat, d;
+#elif defined(__SSE2__)
+	__m128i pat, d;
+#elif defined(__ARM_NEON)
+	uint64x2_t pat, d;
+#else
+	unsigned long long w;
+#endif
+
+	memcpy(&v, buf, sizeof(v));
 
-	for (i = 0; i < page_len; i++)
-		if (vect[i])
+#if defined(__AVX2__)
+	pat = _mm256_set1_epi64x(v);
+	for (i = 0; i < page_size; i += 64) {
+		d = _mm256_or_si256(
+			_mm256_xor_si256(_mm256_loadu_si256((__m256i *)(buf + i)), pat),
+			_mm256_xor_si256(_mm256_loadu_si256((__m256i *)(buf + i + 32)), pat));
+		if (!_mm256_testz_si256(d, d))
+			return FALSE;
+	}
+#elif defined(__SSE2__)
+	pat = _mm_set1_epi64x(v);
+	for (i = 0; i < page_size; i += 64) {
+		d = _mm_or_si128(
+			_mm_or_si128(_mm_xor_si128(_mm_loadu_si128((__m128i *)(buf + i)), pat),
+				     _mm_xor_si128(_mm_loadu_si128((__m128i *)(buf + i + 16)), pat)),
+			_mm_or_si128(_mm_xor_si128(_mm_loadu_si128((__m128i *)(buf + i + 32)), pat),
+				     _mm_xor_si128(_mm_loadu_si128((__m128i *)(buf + i + 48)), pat)));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(d, _mm_setzero_si128())) != 0xffff)
 			return FALSE;
+	}
+#elif defined(__ARM_NEON)
+	pat = vdupq_n_u64(v);
+	for (i = 0; i < page_size; i += 64) {
+		d = vorrq_u64(
+			vorrq_u64(veorq_u64(vld1q_u64((uint64_t *)(buf + i)), pat),
+				  veorq_u64(vld1q_u64((uint64_t *)(buf + i + 16)), pat)),
+			vorrq_u64(veorq_u64(vld1q_u64((uint64_t *)(buf + i + 32)), pat),
+				  veorq_u64(vld1q_u64((uint64_t *)(buf + i + 48)), pat)));
+		if (vgetq_lane_u64(d, 0) | vgetq_lane_u64(d, 1))
+			return FALSE;
+	}
+#else
+	for (i = 0; i < page_size; i += sizeof(w)) {
+		memcpy(&w, buf + i, sizeof(w));
+		if (w != v)
+			return FALSE;
+	}
+#endif
+	*val = v;
 	return TRUE;
 }
 
+static inline int
+is_zero_page(unsigned char *buf, long page_size)
+{
+	unsigned long long val;
+
+	if (*(unsigned long long *)buf)
+		return FALSE;
+
+	return is_filled_page(buf, page_size, &val);
+}
+
+/*
+ * Guess from INCOMPRESSIBLE_SAMPLES bytes sampled over the page whether
+ * it is incompressible, e.g. encrypted or already compressed. Random
+ * bytes take about 221 distinct values in 512 samples, while text and
+ * kernel data take much fewer.
+ */
+#define INCOMPRESSIBLE_SAMPLES	(512)
+#define INCOMPRESSIBLE_VALUES	(200)
+
+static inline int
+is_incompressible_page(unsigned char *buf, long page_size)
+{
+	unsigned char seen[256];
+	long i, step = page_size / INCOMPRESSIBLE_SAMPLES;
+	int nr = 0;
+
+	memset(seen, 0, sizeof(seen));
+	for (i = 0; i < INCOMPRESSIBLE_SAMPLES; i++) {
+		unsigned char c = buf[i * step + (i & 7)];
+
+		nr += !seen[c];
+		seen[c] = 1;
+	}
+
+	return nr >= INCOMPRESSIBLE_VALUES;
+}
+
 void write_vmcoreinfo_data(void);
 int set_bit_on_1st_bitmap(mdf_pfn_t pfn, struct cycle *cycle);
 int clear_bit_on_1st_bitmap(mdf_pfn_t pfn, struct cycle *cycle);
@@ -2506,11 +3048,29 @@ struct elf_prstatus {
 #define OPT_CHECK_PARAMS        OPT_START+18
 #define OPT_DRY_RUN             OPT_START+19
 #define OPT_SHOW_STATS          OPT_START+20
+#define OPT_IO_URING            OPT_START+21
+#define OPT_DEBUGINFO_CACHE     OPT_START+22
+#define OPT_CACHE_SIZE          OPT_START+23
+#define OPT_MEM_MAP_BATCH       OPT_START+24
+#define OPT_SAME_FILLED_PAGES   OPT_START+25
+#define OPT_DEDUP_PAGES         OPT_START+26
+#define OPT_EXTENT_SIZE         OPT_START+27
+#define OPT_ZSTD_DICT           OPT_START+28
+#define OPT_COMPRESS_BUDGET     OPT_START+29
+#define OPT_COMPRESS_LZ4        OPT_START+30
+#define OPT_DIRECT_IO           OPT_START+31
 
 /*
  * Function Prototype.
  */
 mdf_pfn_t get_num_dumpable_cyclic(void);
+void free_page_desc_cache(struct page_desc_cache *pdc);
+void free_mem_map_reader(struct mem_map_reader *reader);
+void init_cycle_bitmap(void);
+void free_cycle_bitmap(void);
+void free_zstd_dict(void);
+int read_pfn(mdf_pfn_t pfn, unsigned char *buf);
+int write_cache(struct cache_data *cd, void *buf, size_t size);
 mdf_pfn_t get_num_dumpable_cyclic_withsplit(void);
 int get_loads_dumpfile_cyclic(void);
 int initial_xen(void);
@@ -43,6 +43,16 @@ show_version(void)
 	MSG("zstd\tenabled\n");
 #else
 	MSG("zstd\tdisabled\n");
+#endif
+#ifdef USELZ4
+	MSG("lz4\tenabled\n");
+#else
+	MSG("lz4\tdisabled\n");
+#endif
+#ifdef USEURING
+	MSG("io_uring\tenabled\n");
+#else
+	MSG("io_uring\tdisabled\n");
 #endif
 	MSG("\n");
 }
@@ -68,6 +78,18 @@ print_usage(void)
 	MSG("  enabled\n");
 #else
 	MSG("  disabled ('-z' option will be ignored.)\n");
+#endif
+	MSG("lz4 support:\n");
+#ifdef USELZ4
+	MSG("  enabled\n");
+#else
+	MSG("  disabled ('--lz4' option will be ignored.)\n");
+#endif
+	MSG("io_uring support:\n");
+#ifdef USEURING
+	MSG("  enabled\n");
+#else
+	MSG("  disabled ('--io-uring' option will be ignored.)\n");
 #endif
 	MSG("\n");
 	MSG("Usage:\n");
@@ -128,6 +150,11 @@ print_usage(void)
 	MSG("      compressed data.\n");
 	MSG("      THIS IS ONLY FOR THE CRASH UTILITY.\n");
 	MSG("\n");
+	MSG("  [--lz4]:\n");
+	MSG("      Compress dump data by each page using lz4, like -c, -l, -p and -z.\n");
+	MSG("      lz4 decompresses pages faster than the others, so that DUMPFILE is\n");
+	MSG("      analyzed faster. Tools which do not know lz4 cannot read DUMPFILE.\n");
+	MSG("\n");
 	MSG("  [-e]:\n");
 	MSG("      Exclude the page structures (vmemmap) which represent excluded pages.\n");
 	MSG("      This greatly shortens the dump of a very large memory system.\n");
@@ -196,6 +223,12 @@ print_usage(void)
 	MSG("      When directory is specified, all the eppic macros in the directory are\n");
 	MSG("      processed\n");
 	MSG("\n");
+	MSG("  [--debuginfo-cache FILE]:\n");
+	MSG("      Used in conjunction with -x VMLINUX option, to save the debugging\n");
+	MSG("      information of VMLINUX needed by makedumpfile into FILE, or to read it\n");
+	MSG("      from FILE if FILE was made from the same VMLINUX. The VMLINUX is\n");
+	MSG("      identified by its build ID, and FILE is not used if VMLINUX has none.\n");
+	MSG("\n");
 	MSG("  [-F]:\n");
 	MSG("      Output the dump data in the flattened format to the standard output\n");
 	MSG("      for transporting the dump data by SSH.\n");
@@ -218,10 +251,19 @@ print_usage(void)
 	MSG("  [--num-threads THREADNUM]:\n");
 	MSG("      Using multiple threads to read and compress data of each page in parallel.\n");
 	MSG("      And it will reduces time for saving DUMPFILE.\n");
+	MSG("      The struct pages are also scanned by the threads to exclude unnecessary\n");
+	MSG("      pages if VMCORE is in elf format.\n");
 	MSG("      Note that if the usable cpu number is less than the thread number, it may\n");
 	MSG("      lead to great performance degradation.\n");
 	MSG("      This feature only supports creating DUMPFILE in kdump-compressed format from\n");
 	MSG("      VMCORE in kdump-compressed format or elf format.\n");
+	MSG("      With --split, all the DUMPFILEs are written at the same time by one\n");
+	MSG("      process, and the THREADNUM threads are shared by them.\n");
+	MSG("\n");
+	MSG("  [--io-uring DEPTH]:\n");
+	MSG("      Use io_uring with up to DEPTH requests in flight to write DUMPFILE, and\n");
+	MSG("      to read VMCORE with --num-threads. read()/write() are used if io_uring\n");
+	MSG("      is unavailable.\n");
 	MSG("\n");
 	MSG("  [--reassemble]:\n");
 	MSG("      Reassemble multiple DUMPFILEs, which are created by --split option,\n");
@@ -243,6 +285,65 @@ print_usage(void)
 	MSG("      By default, BUFFER_SIZE will be calculated automatically depending on\n");
 	MSG("      system memory size, so ordinary users don't need to specify this option.\n");
 	MSG("\n");
+	MSG("  [--cache-size CACHE_SIZE]:\n");
+	MSG("      Specify the size in kilo bytes of the cache for the pages which are\n");
+	MSG("      read to look up kernel data structures, e.g. page tables, free lists,\n");
+	MSG("      module data and the data which filter commands refer to. The default\n");
+	MSG("      is 8 pages. A bigger cache avoids reading the same pages from VMCORE\n");
+	MSG("      repeatedly.\n");
+	MSG("\n");
+	MSG("  [--mem-map-batch NUM]:\n");
+	MSG("      Specify the number of struct pages which are read at a time to exclude\n");
+	MSG("      unnecessary pages. It is rounded down to a power of 2, and the default\n");
+	MSG("      is 16384. With a bigger batch, the struct pages in vmemmap are read\n");
+	MSG("      with fewer reads.\n");
+	MSG("\n");
+	MSG("  [--same-filled-pages]:\n");
+	MSG("      Store a page filled with one repeated 8-byte value only as its page\n");
+	MSG("      descriptor, which holds the value instead of the offset of the page data.\n");
+	MSG("      The header of DUMPFILE is marked with DUMP_DH_FILLED_PAGES. Tools which\n");
+	MSG("      do not know this page descriptor cannot read such DUMPFILE.\n");
+	MSG("      This feature supports only the kdump-compressed format.\n");
+	MSG("\n");
+	MSG("  [--dedup-pages]:\n");
+	MSG("      Write the data of identical pages only once. A page is looked up by its\n");
+	MSG("      hash in a table of the pages written, and if found, its page descriptor\n");
+	MSG("      points to the data written for the identical page without compressing\n");
+	MSG("      the page. The table has 65536 entries. DUMPFILE can be read as usual.\n");
+	MSG("      This feature supports only the kdump-compressed format.\n");
+	MSG("\n");
+	MSG("  [--extent-size EXTENT_SIZE]:\n");
+	MSG("      Compress the dumpable pages in frames of EXTENT_SIZE kilo bytes instead\n");
+	MSG("      of page by page, for a better compression ratio. The page descriptor of\n");
+	MSG("      a page in a frame holds the number of pages in the frame and the index\n");
+	MSG("      of the page, so a page is read by decompressing its frame. The maximum\n");
+	MSG("      is 1024. Tools which do not know such page descriptors cannot read\n");
+	MSG("      DUMPFILE. This option requires -c, -l, -p, -z or --lz4, and cannot be\n");
+	MSG("      used with --num-threads or --dedup-pages.\n");
+	MSG("\n");
+	MSG("  [--zstd-dict]:\n");
+	MSG("      Train a zstd dictionary from the dumpable pages sampled while excluding\n");
+	MSG("      unnecessary pages, and compress every page with it. The dictionary is\n");
+	MSG("      stored in the sub header of DUMPFILE, and loaded once to read DUMPFILE.\n");
+	MSG("      Tools which do not know the dictionary cannot read such DUMPFILE.\n");
+	MSG("      This option requires -z.\n");
+	MSG("\n");
+	MSG("  [--compress-budget MBPS]:\n");
+	MSG("      Choose the compression level of every compressing thread from its\n");
+	MSG("      throughput and ratio measured every 4096 pages. The stronger level is\n");
+	MSG("      chosen while the pages are compressed to 75%% or less at 4 times MBPS\n");
+	MSG("      mega bytes per second or faster, and the fastest level otherwise.\n");
+	MSG("      A page whose sampled bytes look random is written without compressing.\n");
+	MSG("      This option requires -c or -z, and cannot be used with --zstd-dict.\n");
+	MSG("\n");
+	MSG("  [--direct-io]:\n");
+	MSG("      Write the page descriptors and the page data to DUMPFILE with O_DIRECT\n");
+	MSG("      in aligned chunks, so that they do not fill the page cache of the capture\n");
+	MSG("      kernel. The alignment is the one the file system reports for O_DIRECT, or\n");
+	MSG("      the block size of DUMPFILE. Only the unaligned tail of a chunk and the\n");
+	MSG("      headers are written through the page cache. This option is ignored with\n");
+	MSG("      -F, --dry-run and -L, or if the file system does not support O_DIRECT.\n");
+	MSG("\n");
 	MSG("  [--splitblock-size SPLITBLOCK_SIZE]:\n");
 	MSG("      Specify the splitblock size in kilo bytes for analysis with --split.\n");
 	MSG("      If --splitblock N is specified, difference of each splitted dumpfile\n");